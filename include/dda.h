@@ -0,0 +1,97 @@
+#ifndef _RAYC_DDA_H_
+#define _RAYC_DDA_H_ 1
+
+#include <cmath>
+
+#include <rayc/math/vec2.h>
+#include <rayc/math/fixed.h>
+
+namespace rayc {
+
+// Face of a tile a ray entered through
+enum TileSide {
+  SIDE_NORTH, // y-min face
+  SIDE_SOUTH, // y-max face
+  SIDE_WEST,  // x-min face
+  SIDE_EAST,  // x-max face
+};
+
+// Conversions between double and the scalar a walk steps in
+template <typename T>
+struct ScalarTraits {
+  static inline T fromDouble(double value) { return (T)value; }
+  static inline double toDouble(T value) { return (double)value; }
+};
+
+template <>
+struct ScalarTraits<Fixed> {
+  static inline Fixed fromDouble(double value) { return Fixed(value); } // infinity saturates to Fixed::max()
+  static inline double toDouble(Fixed value) { return (double)value; }
+};
+
+// Tile-by-tile grid walk, direction doesn't need to be normalized and distances are in tiles.
+// Set up in double, advance() only adds and compares T, so with Fixed it is integer-only
+template <typename T>
+struct BasicGridDDA {
+  Vec2i tile;
+  Vec2i step;
+  Vec2<T> delta;
+  Vec2<T> side;
+
+  // Distance at which the current tile was entered and the face it was entered through
+  T distance = T(0);
+  TileSide entrySide = SIDE_NORTH;
+
+  inline BasicGridDDA(Vec2d origin, Vec2d direction) {
+    Vec2d deltaD = {
+      sqrt(1 + (direction.y / direction.x) * (direction.y / direction.x)),
+      sqrt(1 + (direction.x / direction.y) * (direction.x / direction.y))
+    };
+    Vec2d sideD;
+
+    tile = {(int)std::floor(origin.x), (int)std::floor(origin.y)};
+
+    if (direction.x < 0) {
+      step.x = -1;
+      sideD.x = (origin.x - tile.x) * deltaD.x;
+    } else {
+      step.x = 1;
+      sideD.x = (tile.x + 1 - origin.x) * deltaD.x;
+    }
+
+    if (direction.y < 0) {
+      step.y = -1;
+      sideD.y = (origin.y - tile.y) * deltaD.y;
+    } else {
+      step.y = 1;
+      sideD.y = (tile.y + 1 - origin.y) * deltaD.y;
+    }
+
+    delta = {ScalarTraits<T>::fromDouble(deltaD.x), ScalarTraits<T>::fromDouble(deltaD.y)};
+    side = {ScalarTraits<T>::fromDouble(sideD.x), ScalarTraits<T>::fromDouble(sideD.y)};
+  }
+
+  inline void advance() {
+    if (side.x < side.y) {
+      distance = side.x;
+      side.x += delta.x;
+      tile.x += step.x;
+      entrySide = step.x > 0 ? SIDE_WEST : SIDE_EAST;
+    } else {
+      distance = side.y;
+      side.y += delta.y;
+      tile.y += step.y;
+      entrySide = step.y > 0 ? SIDE_NORTH : SIDE_SOUTH;
+    }
+  }
+
+  inline double getDistance() const {
+    return ScalarTraits<T>::toDouble(distance);
+  }
+};
+
+typedef BasicGridDDA<double> GridDDA;
+
+} /* namespace rayc */
+
+#endif /* _RAYC_DDA_H_ */
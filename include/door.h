@@ -0,0 +1,61 @@
+#ifndef _RAYC_DOOR_H_
+#define _RAYC_DOOR_H_ 1
+
+#include <vector>
+#include <functional>
+
+#include <rayc/map.h>
+#include <rayc/math/vec2.h>
+
+namespace rayc {
+
+const float DOOR_OPEN_TIME = 1.0f; // seconds from closed to fully open
+const float DOOR_HOLD_TIME = 3.0f; // seconds a door stays open before closing by itself
+
+struct DoorEvent {
+  Vec2i tile;
+  DoorState state; // state the door just entered
+};
+
+// Animates only the doors that are moving or waiting to close, the rest of the map is never visited
+class DoorSystem {
+ private:
+  struct ActiveDoor {
+    Vec2i tile;
+    float opened = 0.0f;
+    float timer = 0.0f;
+  };
+
+  std::vector<ActiveDoor> m_active;
+  std::vector<DoorEvent> m_events;
+  size_t m_moving = 0;
+
+ public:
+  DoorSystem() = default;
+
+  // Picks up the doors the map has open or moving
+  void reset(const Map& map);
+
+  // Returns false when the tile isn't a door
+  bool open(Map& map, Vec2i tile);
+  void close(Map& map, Vec2i tile);
+
+  // isOccupied keeps a door from closing on whatever stands in it
+  void update(Map& map, float frameTime, const std::function<bool(Vec2i)>& isOccupied = {});
+
+  // State changes since the last clearEvents(), for anything caching door state
+  const std::vector<DoorEvent>& getEvents() const;
+  void clearEvents();
+
+  size_t getActiveCount() const;
+  // Doors whose panel moved in the last update(), the ones waiting to close don't count
+  size_t getMovingCount() const;
+
+ private:
+  ActiveDoor& track(Vec2i position, const MapTile& tile);
+  void setState(MapTile& tile, Vec2i position, DoorState state);
+};
+
+} /* namespace rayc */
+
+#endif /* _RAYC_DOOR_H_ */
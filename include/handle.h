@@ -0,0 +1,19 @@
+#ifndef _RAYC_HANDLE_H_
+#define _RAYC_HANDLE_H_ 1
+
+#include <cstdint>
+
+namespace rayc {
+
+// Stays valid across swap-removes, goes stale once the object is destroyed
+struct ObjectHandle {
+  uint32_t index = 0;
+  uint32_t generation = 0;
+
+  inline bool operator==(const ObjectHandle& rhs) const { return index == rhs.index && generation == rhs.generation; }
+  inline bool operator!=(const ObjectHandle& rhs) const { return !(*this == rhs); }
+};
+
+} /* namespace rayc */
+
+#endif /* _RAYC_HANDLE_H_ */
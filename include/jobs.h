@@ -0,0 +1,58 @@
+#ifndef _RAYC_JOBS_H_
+#define _RAYC_JOBS_H_ 1
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <initializer_list>
+
+namespace rayc {
+
+namespace jobs {
+
+using JobFn = std::function<void()>;
+using RangeFn = std::function<void(int, int)>;
+
+struct Job {
+  JobFn fn;
+
+  std::atomic<int> pendingDependencies {1};
+  std::atomic<bool> finished {false};
+
+  std::mutex mutex;
+  std::vector<std::shared_ptr<Job>> continuations;
+};
+
+using JobHandle = std::shared_ptr<Job>;
+
+// workerCount < 0 picks hardware_concurrency()-1, 0 runs everything on the calling thread
+void init(int workerCount = -1);
+void shutdown();
+
+int getWorkerCount();
+bool isMainThread();
+
+// Schedules fn once every job in dependencies has finished
+JobHandle submit(JobFn fn);
+JobHandle submit(JobFn fn, std::initializer_list<JobHandle> dependencies);
+JobHandle submit(JobFn fn, const std::vector<JobHandle>& dependencies);
+JobHandle then(JobHandle job, JobFn fn);
+
+// Runs queued jobs on the calling thread until job is finished
+void wait(JobHandle job);
+void waitAll(const std::vector<JobHandle>& jobs);
+
+// Calls fn(from, to) over [begin, end) split in chunks of at most grainSize, blocks until done
+void parallelFor(int begin, int end, int grainSize, RangeFn fn);
+
+// SDL is not thread safe, anything touching it from a job goes through here
+void runOnMainThread(JobFn fn);
+void processMainThreadQueue();
+
+} /* namespace jobs */
+
+} /* namespace rayc */
+
+#endif /* _RAYC_JOBS_H_ */
@@ -0,0 +1,89 @@
+#ifndef _RAYC_LIGHT_H_
+#define _RAYC_LIGHT_H_ 1
+
+#include <vector>
+#include <cstdint>
+
+#include <rayc/map.h>
+#include <rayc/dda.h>
+#include <rayc/handle.h>
+#include <rayc/math/vec2.h>
+
+namespace rayc {
+
+// Outward normal of a tile face
+Vec2d getFaceNormal(TileSide side);
+Vec2d getFaceCenter(Vec2i tile, TileSide side);
+
+// Static light reaching a point on a surface facing normal, ambient included, a zero normal faces everywhere
+uint8_t sampleStaticLight(const Map& map, Vec2d point, Vec2d normal);
+
+// Fills map.lightmap from map.lights, faces that can't be seen from an open tile are left black
+void bakeLightmap(Map& map);
+// Rebakes only the faces of tiles inside region, map.lightmap has to be allocated already
+void bakeLightmap(Map& map, const MapRegion& region);
+
+// Tiles whose static light can change when tile does: the reach of every map light that can see it
+MapRegion getStaticLightReach(const Map& map, Vec2i tile);
+
+typedef ObjectHandle LightHandle;
+
+// Per-tile light: the static lights sampled once per map plus every dynamic light's shadowed footprint
+class LightGrid {
+ private:
+  struct Light {
+    Vec2d position;
+    float intensity = 0.0f;
+    float radius = 0.0f;
+    uint32_t generation = 1;
+    bool alive = false;
+    bool dirty = false;
+
+    // Tiles this light currently adds to, so it can be taken back out without touching the rest
+    std::vector<std::pair<int, int>> footprint;
+  };
+
+  const Map* m_map = nullptr;
+  std::vector<uint8_t> m_static;
+  std::vector<int> m_dynamic;
+
+  std::vector<Light> m_lights;
+  std::vector<uint32_t> m_freeLights;
+  std::vector<uint32_t> m_dirtyLights;
+
+ public:
+  LightGrid() = default;
+
+  // Keeps a pointer to the map for occlusion, drops every dynamic light
+  void reset(const Map& map);
+
+  LightHandle add(Vec2d position, float intensity, float radius);
+  void move(LightHandle handle, Vec2d position);
+  void setIntensity(LightHandle handle, float intensity);
+  void remove(LightHandle handle);
+  bool isAlive(LightHandle handle) const;
+
+  // The tile changed how it blocks light, every light that can reach it is retraced on the next update
+  void invalidateTile(Vec2i tile);
+  // Samples the static lights again for the tiles inside region
+  void resampleStatic(const MapRegion& region);
+
+  // Retraces only the lights that changed since the last call, returns how many. With a viewer tile,
+  // lights that can't reach anything visible from it per the map's visibility wait until they can
+  int update(Vec2i viewer = {-1, -1});
+
+  uint8_t getLight(Vec2i tile) const;
+  uint8_t getDynamicLight(Vec2i tile) const;
+  // Baked face light plus the dynamic light of the open tile in front of it
+  uint8_t getFaceLight(Vec2i tile, TileSide side) const;
+
+ private:
+  void markDirty(uint32_t index);
+  bool isInView(const Light& light, int viewerCluster) const;
+  void applyFootprint(const Light& light, int sign);
+  void traceFootprint(Light& light) const;
+};
+
+} /* namespace rayc */
+
+#endif /* _RAYC_LIGHT_H_ */
@@ -5,6 +5,7 @@
 #include <vector>
 #include <string>
 
+#include <rayc/dda.h>
 #include <rayc/math/vec2.h>
 
 namespace rayc {
@@ -12,15 +13,27 @@ namespace rayc {
 const uint16_t MAP_MAGIC = 0xffab;
 const uint16_t MAP_FILE_VERSION = 0x0002;
 
+// Optional blocks after the tile data: uint16 tag, uint32 byte size, payload
+enum MapSection {
+  MAP_SECTION_LIGHTS   = 0x0001,
+  MAP_SECTION_LIGHTMAP = 0x0002,
+  MAP_SECTION_FOG      = 0x0003,
+  MAP_SECTION_SURFACES = 0x0004,
+  MAP_SECTION_SKY      = 0x0005,
+  MAP_SECTION_VISIBILITY = 0x0006,
+};
+
 enum TileFlags {
   TILE_VDOOR = 0x1,
   TILE_HDOOR = 0x2,
+  TILE_SEETHROUGH = 0x4, // solid but drawn with holes (windows, fences), rays carry on behind it
 };
 
 enum DoorState {
   DOOR_CLOSED,
   DOOR_OPENING,
   DOOR_OPENED,
+  DOOR_CLOSING,
 };
 
 struct MapTile {
@@ -28,6 +41,8 @@ struct MapTile {
   uint8_t flags;
   uint8_t texture;
   uint8_t height;
+  uint8_t floorTexture = 0;   // 0 keeps the flat floor color
+  uint8_t ceilingTexture = 0; // 0 keeps the flat ceiling color
 
   // state
   DoorState doorState = DOOR_CLOSED;
@@ -38,6 +53,12 @@ struct MapTile {
   bool isDoor() const;
   bool isVDoor() const;
   bool isHDoor() const;
+  bool isSeeThrough() const;
+  // Can be walked through: empty, or a door that is all the way open
+  bool isPassable() const;
+
+  // In tiles, solid tiles saved with 0 count as a regular wall
+  int getWallHeight() const;
 };
 
 struct MapObject {
@@ -46,12 +67,62 @@ struct MapObject {
   uint8_t sprite;
 };
 
+// Point light at the center of a tile, radius in tiles
+struct MapLight {
+  uint16_t x;
+  uint16_t y;
+  uint8_t intensity;
+  uint8_t radius;
+};
+
+// Fades geometry into color between start and end distance, black fog is plain darkness
+struct MapFog {
+  bool enabled = false;
+  uint8_t r = 0;
+  uint8_t g = 0;
+  uint8_t b = 0;
+  float start = 0.0f;
+  float end = 0.0f;
+};
+
+// Which clusters of clusterSize x clusterSize tiles can possibly see each other, empty until built
+struct MapVisibility {
+  uint8_t clusterSize = 0;
+  uint16_t columns = 0;
+  uint16_t rows = 0;
+  std::vector<uint8_t> bits; // one bit per cluster pair, a row of them per viewing cluster
+
+  bool isEmpty() const;
+  void clear();
+
+  int getClusterCount() const;
+  // -1 for tiles off the map
+  int getCluster(Vec2i tile) const;
+
+  // Always true without data, culling is only ever an optimization
+  bool canSee(Vec2i from, Vec2i to) const;
+  bool canSeeCluster(int from, int to) const;
+  // Sets both directions
+  void setVisible(int a, int b);
+
+  // Walls inside the cluster were removed: whatever saw it may now see through it
+  void openCluster(int cluster);
+};
+
+// Tile rectangle, to is exclusive
+struct MapRegion {
+  Vec2i from = {0, 0};
+  Vec2i to = {0, 0};
+
+  bool isEmpty() const;
+  bool contains(Vec2i tile) const;
+  void include(Vec2i tile);
+  void include(const MapRegion& region);
+};
+
 /* TODO:
 
 checksum
-floor/celiling color (when floorcasting is implemented - add floorTexture and ceilingTexture to MapTile)
-
-fog/darkness toggle
 
 */
 
@@ -73,6 +144,15 @@ class Map {
   std::vector<std::string> textures;
   std::vector<std::string> sprites;
 
+  std::vector<MapLight> lights;
+  uint8_t ambientLight = 255;
+  std::vector<uint8_t> lightmap; // 4 faces per tile indexed by TileSide, empty when unlit
+
+  MapFog fog;
+  std::string sky; // panoramic texture shown where tiles have no ceiling texture, empty for none
+
+  MapVisibility visibility;
+
  public:
   Map();
   Map(int w, int h);
@@ -86,6 +166,29 @@ class Map {
   MapTile& getTile(int offset);
   MapTile& getTile(int x, int y);
   MapTile& getTile(Vec2i pos);
+  const MapTile& getTile(int offset) const;
+  const MapTile& getTile(int x, int y) const;
+  const MapTile& getTile(Vec2i pos) const;
+
+  bool contains(int x, int y) const;
+  bool contains(Vec2i pos) const;
+
+  bool hasSurfaces() const;
+  bool hasLightmap() const;
+  uint8_t getLight(Vec2i tile, TileSide side) const;
+
+  // Runtime edit, the tile is recorded so whatever was built from the map can catch up
+  void setTile(Vec2i pos, const MapTile& tile);
+  void markDirty(Vec2i pos);
+
+  // Tiles edited since the last clearChanges(), each listed once
+  const std::vector<Vec2i>& getChanges() const;
+  const MapRegion& getDirtyRegion() const;
+  void clearChanges();
+
+ private:
+  std::vector<Vec2i> m_changes;
+  MapRegion m_dirtyRegion;
 };
 
 } /* namespace rayc */
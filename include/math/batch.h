@@ -0,0 +1,25 @@
+#ifndef _RAYC_MATH_BATCH_H_
+#define _RAYC_MATH_BATCH_H_ 1
+
+#include <cstddef>
+
+#include <rayc/math/vec2.h>
+
+namespace rayc {
+
+// Array passes on Vec2fxN with a scalar tail, outputs may alias the matching inputs
+
+// Camera space of every point: depth along forward and lateral offset along right
+void transformPoints(const Vec2d* points, size_t count, Vec2d origin, Vec2d forward, Vec2d right, float* depth, float* lateral);
+
+void dotBatch(const float* ax, const float* ay, const float* bx, const float* by, float* out, size_t count);
+void lengthBatch(const float* x, const float* y, float* out, size_t count);
+// Zero vectors stay zero
+void normalizeBatch(float* x, float* y, size_t count);
+
+// out[i] = positions[i] + velocities[i] * time, in double since positions are, two lanes per SSE2 register
+void integrateBatch(const Vec2d* positions, const Vec2d* velocities, Vec2d* out, size_t count, double time);
+
+} /* namespace rayc */
+
+#endif /* _RAYC_MATH_BATCH_H_ */
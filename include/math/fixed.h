@@ -0,0 +1,49 @@
+#ifndef _RAYC_MATH_FIXED_H_
+#define _RAYC_MATH_FIXED_H_ 1
+
+#include <cstdint>
+#include <cmath>
+
+namespace rayc {
+
+// 16.16 fixed point, add, subtract and compare are plain integer ops with the same result everywhere
+struct Fixed {
+  static constexpr int SHIFT = 16;
+  static constexpr int32_t ONE = 1 << SHIFT;
+
+  int32_t raw = 0;
+
+  constexpr Fixed() = default;
+  explicit constexpr Fixed(int value) : raw(value * ONE) {}
+  // Out of range values, infinities and NaN saturate
+  explicit Fixed(double value) : raw(value < 32767.0 ? value > -32767.0 ? (int32_t)std::lround(value * ONE) : -INT32_MAX : INT32_MAX) {}
+
+  static constexpr Fixed fromRaw(int32_t raw) { Fixed value; value.raw = raw; return value; }
+  static constexpr Fixed max() { return fromRaw(INT32_MAX); }
+
+  explicit operator double() const { return raw / (double)ONE; }
+  explicit operator float() const { return raw / (float)ONE; }
+  // Rounds toward negative infinity like std::floor
+  explicit operator int() const { return raw >> SHIFT; }
+
+  inline Fixed  operator +(Fixed rhs) const { return fromRaw(raw + rhs.raw); }
+  inline Fixed  operator -(Fixed rhs) const { return fromRaw(raw - rhs.raw); }
+  inline Fixed  operator *(Fixed rhs) const { return fromRaw((int32_t)(((int64_t)raw * rhs.raw) >> SHIFT)); }
+  inline Fixed  operator /(Fixed rhs) const { return fromRaw((int32_t)(((int64_t)raw << SHIFT) / rhs.raw)); }
+  inline Fixed  operator -() const { return fromRaw(-raw); }
+  inline Fixed& operator+=(Fixed rhs) { raw += rhs.raw; return *this; }
+  inline Fixed& operator-=(Fixed rhs) { raw -= rhs.raw; return *this; }
+  inline Fixed& operator*=(Fixed rhs) { return *this = *this * rhs; }
+  inline Fixed& operator/=(Fixed rhs) { return *this = *this / rhs; }
+
+  inline bool operator==(Fixed rhs) const { return raw == rhs.raw; }
+  inline bool operator!=(Fixed rhs) const { return raw != rhs.raw; }
+  inline bool operator <(Fixed rhs) const { return raw < rhs.raw; }
+  inline bool operator<=(Fixed rhs) const { return raw <= rhs.raw; }
+  inline bool operator >(Fixed rhs) const { return raw > rhs.raw; }
+  inline bool operator>=(Fixed rhs) const { return raw >= rhs.raw; }
+};
+
+} /* namespace rayc */
+
+#endif /* _RAYC_MATH_FIXED_H_ */
@@ -32,7 +32,7 @@ struct Vec2 {
   inline Vec2<T>  operator /(const Vec2<T>& rhs) const { return {x / rhs.x, y / rhs.y}; }
   inline Vec2<T>  operator /(const T& rhs) const { return {x / rhs, y / rhs}; }
   inline Vec2<T>& operator+=(const Vec2<T>& rhs) { x += rhs.x; y += rhs.y; return *this; }
-  inline Vec2<T>& operator+=(const T& rhs) { x += rhs; y = rhs; return *this; }
+  inline Vec2<T>& operator+=(const T& rhs) { x += rhs; y += rhs; return *this; }
   inline Vec2<T>& operator-=(const Vec2<T>& rhs) { x -= rhs.x; y -= rhs.y; return *this; }
   inline Vec2<T>& operator-=(const T& rhs) { x -= rhs; y -= rhs; return *this; }
   inline Vec2<T>& operator*=(const Vec2<T>& rhs) { x *= rhs.x; y *= rhs.y; return *this; }
@@ -0,0 +1,150 @@
+#ifndef _RAYC_MATH_VEC2X_H_
+#define _RAYC_MATH_VEC2X_H_ 1
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+#include <rayc/math/vec2.h>
+
+namespace rayc {
+
+// 4 float lanes, SSE when the target has it
+struct Floatx4 {
+  static const int WIDTH = 4;
+
+#if defined(__SSE__)
+  __m128 v;
+
+  inline Floatx4() : v(_mm_setzero_ps()) {}
+  inline Floatx4(__m128 v) : v(v) {}
+  inline Floatx4(float value) : v(_mm_set1_ps(value)) {}
+
+  static inline Floatx4 load(const float* data) { return _mm_loadu_ps(data); }
+  inline void store(float* data) const { _mm_storeu_ps(data, v); }
+
+  inline Floatx4 operator+(const Floatx4& rhs) const { return _mm_add_ps(v, rhs.v); }
+  inline Floatx4 operator-(const Floatx4& rhs) const { return _mm_sub_ps(v, rhs.v); }
+  inline Floatx4 operator*(const Floatx4& rhs) const { return _mm_mul_ps(v, rhs.v); }
+  inline Floatx4 operator/(const Floatx4& rhs) const { return _mm_div_ps(v, rhs.v); }
+
+  friend inline Floatx4 sqrt(const Floatx4& value) { return _mm_sqrt_ps(value.v); }
+  friend inline Floatx4 max(const Floatx4& a, const Floatx4& b) { return _mm_max_ps(a.v, b.v); }
+#else
+  float v[WIDTH];
+
+  inline Floatx4() : v{0, 0, 0, 0} {}
+  inline Floatx4(float value) : v{value, value, value, value} {}
+
+  static inline Floatx4 load(const float* data) { Floatx4 r; for (int i = 0; i < WIDTH; i++) r.v[i] = data[i]; return r; }
+  inline void store(float* data) const { for (int i = 0; i < WIDTH; i++) data[i] = v[i]; }
+
+  inline Floatx4 operator+(const Floatx4& rhs) const { Floatx4 r; for (int i = 0; i < WIDTH; i++) r.v[i] = v[i] + rhs.v[i]; return r; }
+  inline Floatx4 operator-(const Floatx4& rhs) const { Floatx4 r; for (int i = 0; i < WIDTH; i++) r.v[i] = v[i] - rhs.v[i]; return r; }
+  inline Floatx4 operator*(const Floatx4& rhs) const { Floatx4 r; for (int i = 0; i < WIDTH; i++) r.v[i] = v[i] * rhs.v[i]; return r; }
+  inline Floatx4 operator/(const Floatx4& rhs) const { Floatx4 r; for (int i = 0; i < WIDTH; i++) r.v[i] = v[i] / rhs.v[i]; return r; }
+
+  friend inline Floatx4 sqrt(const Floatx4& value) { Floatx4 r; for (int i = 0; i < WIDTH; i++) r.v[i] = std::sqrt(value.v[i]); return r; }
+  friend inline Floatx4 max(const Floatx4& a, const Floatx4& b) { Floatx4 r; for (int i = 0; i < WIDTH; i++) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return r; }
+#endif
+};
+
+// 8 float lanes, AVX when the target has it, two Floatx4 otherwise
+struct Floatx8 {
+  static const int WIDTH = 8;
+
+#if defined(__AVX__)
+  __m256 v;
+
+  inline Floatx8() : v(_mm256_setzero_ps()) {}
+  inline Floatx8(__m256 v) : v(v) {}
+  inline Floatx8(float value) : v(_mm256_set1_ps(value)) {}
+
+  static inline Floatx8 load(const float* data) { return _mm256_loadu_ps(data); }
+  inline void store(float* data) const { _mm256_storeu_ps(data, v); }
+
+  inline Floatx8 operator+(const Floatx8& rhs) const { return _mm256_add_ps(v, rhs.v); }
+  inline Floatx8 operator-(const Floatx8& rhs) const { return _mm256_sub_ps(v, rhs.v); }
+  inline Floatx8 operator*(const Floatx8& rhs) const { return _mm256_mul_ps(v, rhs.v); }
+  inline Floatx8 operator/(const Floatx8& rhs) const { return _mm256_div_ps(v, rhs.v); }
+
+  friend inline Floatx8 sqrt(const Floatx8& value) { return _mm256_sqrt_ps(value.v); }
+  friend inline Floatx8 max(const Floatx8& a, const Floatx8& b) { return _mm256_max_ps(a.v, b.v); }
+#else
+  Floatx4 lo;
+  Floatx4 hi;
+
+  inline Floatx8() = default;
+  inline Floatx8(const Floatx4& lo, const Floatx4& hi) : lo(lo), hi(hi) {}
+  inline Floatx8(float value) : lo(value), hi(value) {}
+
+  static inline Floatx8 load(const float* data) { return {Floatx4::load(data), Floatx4::load(data + 4)}; }
+  inline void store(float* data) const { lo.store(data); hi.store(data + 4); }
+
+  inline Floatx8 operator+(const Floatx8& rhs) const { return {lo + rhs.lo, hi + rhs.hi}; }
+  inline Floatx8 operator-(const Floatx8& rhs) const { return {lo - rhs.lo, hi - rhs.hi}; }
+  inline Floatx8 operator*(const Floatx8& rhs) const { return {lo * rhs.lo, hi * rhs.hi}; }
+  inline Floatx8 operator/(const Floatx8& rhs) const { return {lo / rhs.lo, hi / rhs.hi}; }
+
+  friend inline Floatx8 sqrt(const Floatx8& value) { return {sqrt(value.lo), sqrt(value.hi)}; }
+  friend inline Floatx8 max(const Floatx8& a, const Floatx8& b) { return {max(a.lo, b.lo), max(a.hi, b.hi)}; }
+#endif
+};
+
+// F::WIDTH 2D vectors in structure of arrays layout, lane i of x and y is vector i
+template <typename F>
+struct Vec2x {
+  static const int WIDTH = F::WIDTH;
+
+  F x;
+  F y;
+
+  inline Vec2x() = default;
+  inline Vec2x(const F& x, const F& y) : x(x), y(y) {}
+  // Every lane set to the same vector
+  inline Vec2x(Vec2f value) : x(value.x), y(value.y) {}
+
+  static inline Vec2x load(const float* xs, const float* ys) { return {F::load(xs), F::load(ys)}; }
+  inline void store(float* xs, float* ys) const { x.store(xs); y.store(ys); }
+
+  // Converts WIDTH interleaved double vectors, e.g. straight from an ObjectPool
+  static inline Vec2x loadPoints(const Vec2d* points) {
+    float xs[WIDTH], ys[WIDTH];
+    for (int i = 0; i < WIDTH; i++) {
+      xs[i] = points[i].x;
+      ys[i] = points[i].y;
+    }
+    return load(xs, ys);
+  }
+
+  inline Vec2x operator+(const Vec2x& rhs) const { return {x + rhs.x, y + rhs.y}; }
+  inline Vec2x operator-(const Vec2x& rhs) const { return {x - rhs.x, y - rhs.y}; }
+  inline Vec2x operator*(const F& rhs) const { return {x * rhs, y * rhs}; }
+  inline Vec2x operator/(const F& rhs) const { return {x / rhs, y / rhs}; }
+
+  inline F dot(const Vec2x& rhs) const { return x * rhs.x + y * rhs.y; }
+  inline F length() const { return sqrt(dot(*this)); }
+
+  // Zero vectors stay zero
+  inline Vec2x normalized() const { return *this / max(length(), F(1e-30f)); }
+};
+
+typedef Vec2x<Floatx4> Vec2fx4;
+typedef Vec2x<Floatx8> Vec2fx8;
+
+// Widest batch the target compiles to natively
+#if defined(__AVX__)
+typedef Vec2fx8 Vec2fxN;
+#else
+typedef Vec2fx4 Vec2fxN;
+#endif
+
+} /* namespace rayc */
+
+#endif /* _RAYC_MATH_VEC2X_H_ */
@@ -1,6 +1,9 @@
 #ifndef _RAYC_VIDEO_VEC3_H_
 #define _RAYC_VIDEO_VEC3_H_ 1
 
+#include <string>
+#include <cmath>
+
 namespace rayc {
 
 template <typename T>
@@ -19,8 +22,35 @@ struct Vec3 {
     return *this;
   }
 
-  inline bool operator==(const Vec3<T>& rhs) const { return x == rhs.x && y == rhs.y && z == rhs.z; }
-  inline bool operator!=(const Vec3<T>& rhs) const { return x != rhs.x || y != rhs.y || z != rhs.z; }
+  inline T dot(const Vec3<T>& rhs) const { return x * rhs.x + y * rhs.y + z * rhs.z; }
+  inline Vec3<T> cross(const Vec3<T>& rhs) const { return {y * rhs.z - z * rhs.y, z * rhs.x - x * rhs.z, x * rhs.y - y * rhs.x}; }
+  inline T length() const { return std::sqrt(dot(*this)); }
+
+  inline Vec3<T>  operator +(const Vec3<T>& rhs) const { return {x + rhs.x, y + rhs.y, z + rhs.z}; }
+  inline Vec3<T>  operator +(const T& rhs) const { return {x + rhs, y + rhs, z + rhs}; }
+  inline Vec3<T>  operator -(const Vec3<T>& rhs) const { return {x - rhs.x, y - rhs.y, z - rhs.z}; }
+  inline Vec3<T>  operator -(const T& rhs) const { return {x - rhs, y - rhs, z - rhs}; }
+  inline Vec3<T>  operator *(const Vec3<T>& rhs) const { return {x * rhs.x, y * rhs.y, z * rhs.z}; }
+  inline Vec3<T>  operator *(const T& rhs) const { return {x * rhs, y * rhs, z * rhs}; }
+  inline Vec3<T>  operator /(const Vec3<T>& rhs) const { return {x / rhs.x, y / rhs.y, z / rhs.z}; }
+  inline Vec3<T>  operator /(const T& rhs) const { return {x / rhs, y / rhs, z / rhs}; }
+  inline Vec3<T>& operator+=(const Vec3<T>& rhs) { x += rhs.x; y += rhs.y; z += rhs.z; return *this; }
+  inline Vec3<T>& operator+=(const T& rhs) { x += rhs; y += rhs; z += rhs; return *this; }
+  inline Vec3<T>& operator-=(const Vec3<T>& rhs) { x -= rhs.x; y -= rhs.y; z -= rhs.z; return *this; }
+  inline Vec3<T>& operator-=(const T& rhs) { x -= rhs; y -= rhs; z -= rhs; return *this; }
+  inline Vec3<T>& operator*=(const Vec3<T>& rhs) { x *= rhs.x; y *= rhs.y; z *= rhs.z; return *this; }
+  inline Vec3<T>& operator*=(const T& rhs) { x *= rhs; y *= rhs; z *= rhs; return *this; }
+  inline Vec3<T>& operator/=(const Vec3<T>& rhs) { x /= rhs.x; y /= rhs.y; z /= rhs.z; return *this; }
+  inline Vec3<T>& operator/=(const T& rhs) { x /= rhs; y /= rhs; z /= rhs; return *this; }
+  inline Vec3<T>  operator-() const { return {-x, -y, -z}; }
+  inline bool     operator==(const Vec3<T>& rhs) const { return x == rhs.x && y == rhs.y && z == rhs.z; }
+  inline bool     operator!=(const Vec3<T>& rhs) const { return x != rhs.x || y != rhs.y || z != rhs.z; }
+
+  inline std::string toString() const { return "(" + std::to_string(x) + ", " + std::to_string(y) + ", " + std::to_string(z) + ")"; }
+  inline operator Vec3<int>() const { return Vec3<int>((int)x, (int)y, (int)z); }
+  inline operator Vec3<unsigned int>() const { return Vec3<unsigned int>((unsigned int)x, (unsigned int)y, (unsigned int)z); }
+  inline operator Vec3<float>() const { return Vec3<float>((float)x, (float)y, (float)z); }
+  inline operator Vec3<double>() const { return Vec3<double>((double)x, (double)y, (double)z); }
 };
 
 typedef Vec3<int> Vec3i;
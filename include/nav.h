@@ -0,0 +1,96 @@
+#ifndef _RAYC_NAV_H_
+#define _RAYC_NAV_H_ 1
+
+#include <vector>
+#include <cstdint>
+
+#include <rayc/map.h>
+#include <rayc/jobs.h>
+#include <rayc/math/vec2.h>
+
+namespace rayc {
+
+// Integration + flow field toward one goal tile, 8-connected without corner cutting
+class FlowField {
+ public:
+  static constexpr uint32_t UNREACHABLE = 0xffffffff;
+  static constexpr uint8_t NO_FLOW = 0xff;
+
+ private:
+  int m_width = 0;
+  int m_height = 0;
+  Vec2i m_goal = {-1, -1};
+
+  std::vector<uint8_t> m_walkable;
+  std::vector<uint32_t> m_cost;
+  std::vector<uint8_t> m_flow; // neighbour index toward the goal
+
+  // scratch for incremental repairs
+  std::vector<uint8_t> m_invalid;
+  std::vector<int> m_invalidated;
+  std::vector<uint64_t> m_queue;
+
+ public:
+  FlowField() = default;
+
+  // Snapshots walkability, the field never reads the map after this
+  void reset(const Map& map);
+  void rebuild();
+
+  void setGoal(Vec2i goal);
+  // Only touches the part of the field whose distances actually change
+  void setWalkable(Vec2i tile, bool walkable);
+
+  Vec2i getGoal() const;
+  uint32_t getCost(Vec2i tile) const;
+  bool isWalkable(Vec2i tile) const;
+
+  // Unit vector toward the next tile center on the way to the goal, zero at the goal or when stuck
+  Vec2d getDirection(Vec2d position) const;
+
+  static bool isWalkable(const MapTile& tile);
+
+ private:
+  bool canMove(int x, int y, int direction) const;
+  void push(int index, uint32_t cost);
+  void propagate();
+  void invalidateFrom(int index);
+  void repairInvalidated();
+};
+
+// Shared goal field kept up to date on the job pool, NPCs read the last finished one
+class NavService {
+ private:
+  struct Change {
+    bool isGoal;
+    Vec2i tile;
+    bool walkable;
+  };
+
+  FlowField m_fields[2];
+  int m_front = 0;
+  Vec2i m_requestedGoal = {-1, -1};
+
+  jobs::JobHandle m_job;
+  std::vector<Change> m_pending;
+  std::vector<Change> m_running;
+
+ public:
+  NavService() = default;
+  ~NavService();
+
+  void reset(const Map& map, Vec2i goal);
+
+  void setGoal(Vec2i goal);
+  void setWalkable(Vec2i tile, bool walkable);
+
+  // Main thread, once per tick: publishes a finished field and starts the next one
+  void update();
+  void wait();
+
+  const FlowField& getField() const;
+};
+
+} /* namespace rayc */
+
+#endif /* _RAYC_NAV_H_ */
@@ -1,8 +1,17 @@
 #ifndef _RAYC_OBJECT_H_
 #define _RAYC_OBJECT_H_ 1
 
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <rayc/map.h>
+#include <rayc/dda.h>
+#include <rayc/nav.h>
+#include <rayc/handle.h>
+#include <rayc/spatial.h>
 #include <rayc/math/vec2.h>
-#include <rayc/video/texture.h>
 
 namespace rayc {
 
@@ -10,28 +19,112 @@ enum GameObjectType {
   OBJTYPE_STATIONARY,
   OBJTYPE_PROJECTILE,
   OBJTYPE_NPC,
+
+  OBJTYPE_COUNT
+};
+
+const float NPC_SPEED = 2.0f;
+
+enum GameObjectFlags {
+  OBJFLAG_VISIBLE = 0x1,
+  OBJFLAG_REMOVE  = 0x2,
 };
 
-struct GameObject {
-  GameObjectType type = OBJTYPE_STATIONARY;
+// All objects of one type, each field in its own contiguous array
+struct ObjectPool {
+  std::vector<Vec2d> position;
+  std::vector<Vec2d> velocity;
+  std::vector<uint16_t> sprite;
+  std::vector<uint8_t> flags;
+  std::vector<float> radius;
+  std::vector<uint32_t> slot;
+
+  inline size_t size() const { return position.size(); }
+};
+
+struct ProjectileImpact {
+  ObjectHandle handle; // already stale, the projectile is removed in the same update
+  Vec2d point;
+  Vec2i tile;
+  TileSide side;
+};
+
+// Scratch arrays reused by the projectile sweep between ticks
+struct ProjectileSweep {
+  std::vector<Vec2d> target;
+  std::vector<uint32_t> crossing;
+  std::vector<ProjectileImpact> impacts;
+};
 
-  Vec2d position = {0, 0};
-  Vec2d velocity = {0, 0};
+class ObjectStore {
+ private:
+  struct Slot {
+    uint32_t generation = 1;
+    uint8_t type = OBJTYPE_STATIONARY;
+    uint32_t index = 0;
+    bool alive = false;
+  };
 
-  bool visible = true;
-  bool remove = false;
+  std::array<ObjectPool, OBJTYPE_COUNT> m_pools;
+  std::vector<Slot> m_slots;
+  std::vector<uint32_t> m_freeSlots;
+  size_t m_count = 0;
 
-  Texture* texture;
+  SpatialHash m_spatial;
+  std::vector<ObjectHandle> m_queryResult;
+  ProjectileSweep m_sweep;
 
  public:
-  GameObject() = default;
-  GameObject(Vec2d position, Texture* texture);
-  GameObject(GameObjectType type, Vec2d position, Vec2d velocity, Texture* texture);
+  ObjectStore() = default;
 
-  virtual void onCollision(GameObject* collided);
-  virtual void onFrameUpdate(float frameTile);
+  // Sizes the spatial hash, call before creating objects for a map
+  void setBounds(int width, int height, int cellSize = 1);
+
+  ObjectHandle create(GameObjectType type, Vec2d position, Vec2d velocity, int sprite, float radius = 0.25f, uint8_t flags = OBJFLAG_VISIBLE);
+  void destroy(ObjectHandle handle);
+  bool isAlive(ObjectHandle handle) const;
+
+  // Deferred destroy, applied by removeMarked() once the current pass is done
+  void markForRemoval(ObjectHandle handle);
+  void removeMarked();
+
+  ObjectHandle getHandle(GameObjectType type, size_t index) const;
+  GameObjectType getType(ObjectHandle handle) const;
+  Vec2d& getPosition(ObjectHandle handle);
+  Vec2d& getVelocity(ObjectHandle handle);
+  uint8_t& getFlags(ObjectHandle handle);
+  uint16_t getSprite(ObjectHandle handle) const;
+  float getRadius(ObjectHandle handle) const;
+
+  // Call after changing a position through getPosition() outside of update()
+  void syncPosition(ObjectHandle handle);
+  const SpatialHash& getSpatialHash() const;
+
+  // Wall hits of projectiles from the last update()
+  const std::vector<ProjectileImpact>& getImpacts() const;
+
+  ObjectPool& getPool(GameObjectType type);
+  const ObjectPool& getPool(GameObjectType type) const;
+
+  size_t size() const;
+  void clear();
+
+  // Runs every per-type system over its pool, then drops removed objects. With a viewer tile,
+  // NPCs the map's visibility says can't be seen from it sleep
+  void update(Map& map, float frameTime, const FlowField* flow = nullptr, Vec2i viewer = {-1, -1});
+
+ private:
+  void removeAt(GameObjectType type, size_t index);
+  void syncPool(GameObjectType type);
+  void collideProjectiles();
 };
 
+// Sweeps each projectile's step through the tile grid, impacts get the pool index in handle.index
+void updateProjectiles(ObjectPool& pool, Map& map, float frameTime, ProjectileSweep& sweep);
+
+// One flow field lookup per NPC, no per-NPC search; NPCs in clusters hidden from viewerCluster stay put
+void updateNpcs(ObjectPool& pool, const FlowField& flow, float frameTime, const MapVisibility* visibility = nullptr, int viewerCluster = -1);
+
 } /* namespace rayc */
 
 #endif /* _RAYC_OBJECT_H_ */
\ No newline at end of file
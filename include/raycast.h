@@ -0,0 +1,127 @@
+#ifndef _RAYC_RAYCAST_H_
+#define _RAYC_RAYCAST_H_ 1
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <rayc/map.h>
+#include <rayc/dda.h>
+#include <rayc/jobs.h>
+#include <rayc/handle.h>
+#include <rayc/math/vec2.h>
+
+namespace rayc {
+
+class ObjectStore;
+
+// Scalar the ray core steps through the grid in, picked at compile time: 16.16 fixed point with
+// RAYC_FIXED_POINT_RAYS for bit-exact walks on every compiler and CPU, float otherwise
+#ifdef RAYC_FIXED_POINT_RAYS
+typedef Fixed RayScalar;
+#else
+typedef float RayScalar;
+#endif
+
+typedef BasicGridDDA<RayScalar> RayDDA;
+
+enum RayFlags {
+  RAY_BLOCK_OPEN_DOORS = 0x1, // doors stop the ray in any state, not only when closed
+  RAY_IGNORE_DOORS     = 0x2, // doors never stop the ray
+  RAY_HIT_OBJECTS      = 0x4, // object circles stop the ray, needs an ObjectStore
+  RAY_STOP_SEETHROUGH  = 0x8, // see-through tiles stop the ray like walls
+};
+
+enum RayHitType {
+  RAYHIT_NONE,
+  RAYHIT_WALL,
+  RAYHIT_DOOR,
+  RAYHIT_OBJECT,
+};
+
+struct Ray {
+  Vec2d origin;
+  Vec2d direction; // doesn't have to be normalized
+  float maxDistance = 100.0f;
+  uint8_t flags = 0;
+  ObjectHandle ignore; // usually whoever fired the ray
+};
+
+struct RayHit {
+  RayHitType type = RAYHIT_NONE;
+  float distance = 0.0f; // euclidean, maxDistance or the map edge when nothing was hit
+  Vec2d point;
+
+  // Tile hits only
+  Vec2i tile;
+  TileSide side = SIDE_NORTH;
+  float sampleX = 0.0f; // position along the face, 0..1
+
+  // Object hits only
+  ObjectHandle object;
+};
+
+// See-through tiles in front of the opaque hits, nearest first; fixed size so a column never allocates
+struct SeeThroughHits {
+  static const int CAPACITY = 4;
+
+  RayHit hits[CAPACITY];
+  int count = 0;
+};
+
+// Rays only read the map and the object store, any number may run at once as long as neither changes meanwhile
+RayHit castRay(const Map& map, const Ray& ray, const ObjectStore* objects = nullptr);
+void castRays(const Map& map, const Ray* rays, RayHit* hits, size_t count, const ObjectStore* objects = nullptr);
+
+// Every wall still visible over the nearer ones from eyeHeight, front to back, until the sightline
+// slope reaches coveredSlope or nothing up to maxHeight could show any more; returns the hit count.
+// Visible see-through tiles on the way go to seeThrough, or are skipped without it
+int castRayLayers(const Map& map, const Ray& ray, float eyeHeight, float coveredSlope, float maxHeight, RayHit* hits, int capacity, SeeThroughHits* seeThrough = nullptr);
+
+bool hasLineOfSight(const Map& map, Vec2d from, Vec2d to, uint8_t flags = 0);
+
+// Moves a wall hit to where ray crosses the same tile face, false when the ray misses that face.
+// Says nothing about what may stand in front of it, the caller has to know that from elsewhere
+bool reprojectHit(const Ray& ray, RayHit& hit);
+
+// Column setup of the renderer: eye height over the floor and hits kept per column
+const float COLUMN_EYE_HEIGHT = 0.5f;
+const int COLUMN_MAX_LAYERS = 8;
+
+// A wall of height 1 reaches the top of the screen at a quarter tile per tile of depth
+float getCoveredSlope(float rayAngle, float viewAngle);
+
+// Column x of a frame laid out COLUMN_MAX_LAYERS hits per column may reuse its last hit only when it
+// and both fresh neighbours are plain single-layer walls on the same face
+bool canReprojectColumn(const RayHit* hits, const uint8_t* layers, const SeeThroughHits* seeThrough, int x, int width);
+// Moves column x's hit onto ray when allowed, false when it has to be cast again
+bool reprojectColumn(const Ray& ray, RayHit* hits, const uint8_t* layers, const SeeThroughHits* seeThrough, int x, int width);
+
+// Collects queries during a tick and resolves them on the job pool, e.g. every NPC's visibility check
+class RayBatch {
+ private:
+  std::vector<Ray> m_rays;
+  std::vector<RayHit> m_hits;
+  jobs::JobHandle m_job;
+
+ public:
+  RayBatch() = default;
+  ~RayBatch();
+
+  // Returns the index of the hit, only valid until clear()
+  size_t add(const Ray& ray);
+  void clear();
+  size_t size() const;
+
+  // Casts in chunks of grainSize rays, returns right away
+  void submit(const Map& map, const ObjectStore* objects = nullptr, int grainSize = 64);
+  bool isFinished() const;
+  void wait();
+
+  const RayHit& getHit(size_t index) const;
+  const std::vector<RayHit>& getHits() const;
+};
+
+} /* namespace rayc */
+
+#endif /* _RAYC_RAYCAST_H_ */
@@ -0,0 +1,65 @@
+#ifndef _RAYC_REFERENCE_H_
+#define _RAYC_REFERENCE_H_ 1
+
+#include <vector>
+#include <cstdint>
+
+#include <rayc/map.h>
+#include <rayc/raycast.h>
+#include <rayc/math/vec2.h>
+
+namespace rayc {
+
+// Plain scalar renderer kept as the ground truth for the optimized paths. Everything here walks the
+// grid in double one ray at a time and is not meant to be fast, only to stay put
+namespace reference {
+
+// Same contract as rayc::castRay without objects
+RayHit castRay(const Map& map, const Ray& ray);
+
+// Same contract as rayc::castRayLayers without see-through tiles
+int castRayLayers(const Map& map, const Ray& ray, float eyeHeight, float coveredSlope, float maxHeight, RayHit* hits, int capacity);
+
+struct View {
+  Vec2d position;
+  float angle = 0.0f;
+  float fov = 1.0471976f;
+  float rayDistance = 100.0f;
+};
+
+struct Sprite {
+  uint32_t id = 0;
+  float depth = 0.0f;   // along the view direction
+  float lateral = 0.0f; // along the right vector
+};
+
+// CPU frame both paths draw into, walls are flat colored by texture, face and texel column so any
+// change in what a column sees shows up as a pixel difference
+struct Frame {
+  int width = 0;
+  int height = 0;
+  std::vector<uint32_t> pixels;
+  std::vector<float> depth; // per column, nearest opaque wall
+
+  Frame() = default;
+  Frame(int width, int height);
+
+  void clear();
+  uint32_t getPixel(int x, int y) const;
+};
+
+// Ray for column x, the same spread by angle the game uses
+Ray getColumnRay(const View& view, int x, int width);
+float getColumnAngle(const View& view, int x, int width);
+float getCoveredSlope(const View& view, int x, int width);
+
+// Draws a column's layers front to back, hits as returned by castRayLayers
+void drawColumn(Frame& frame, const Map& map, const View& view, int x, const RayHit* hits, int count);
+// Sprites have to be sorted back to front, columns are depth tested against frame.depth
+void drawSprites(Frame& frame, const View& view, const Sprite* sprites, size_t count);
+
+} /* namespace reference */
+
+} /* namespace rayc */
+
+#endif /* _RAYC_REFERENCE_H_ */
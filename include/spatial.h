@@ -0,0 +1,58 @@
+#ifndef _RAYC_SPATIAL_H_
+#define _RAYC_SPATIAL_H_ 1
+
+#include <vector>
+#include <cstdint>
+
+#include <rayc/handle.h>
+#include <rayc/math/vec2.h>
+
+namespace rayc {
+
+// Uniform grid of cellSize x cellSize tile buckets, objects are filed by their centre
+class SpatialHash {
+ private:
+  struct Entry {
+    ObjectHandle handle;
+    Vec2d position;
+    float radius = 0.0f;
+    int cell = -1;
+    uint32_t cellSlot = 0;
+  };
+
+  int m_cellSize = 1;
+  int m_columns = 0;
+  int m_rows = 0;
+  float m_maxRadius = 0.0f;
+
+  std::vector<Entry> m_entries; // indexed by ObjectHandle::index
+  std::vector<std::vector<uint32_t>> m_cells;
+
+ public:
+  SpatialHash() = default;
+
+  void reset(int mapWidth, int mapHeight, int cellSize = 1);
+  void clear();
+
+  void insert(ObjectHandle handle, Vec2d position, float radius);
+  void move(ObjectHandle handle, Vec2d position);
+  void remove(ObjectHandle handle);
+  bool contains(ObjectHandle handle) const;
+
+  // Appends every object whose circle touches the query circle
+  void queryRadius(Vec2d center, float radius, std::vector<ObjectHandle>& result) const;
+  void queryOverlaps(ObjectHandle handle, std::vector<ObjectHandle>& result) const;
+  bool overlaps(ObjectHandle a, ObjectHandle b) const;
+
+  // Nearest object circle along the ray, direction doesn't have to be normalized
+  bool queryRay(Vec2d origin, Vec2d direction, float maxDistance, ObjectHandle& hit, float& distance, ObjectHandle ignore = {}) const;
+
+ private:
+  int getCell(Vec2d position) const;
+  void link(uint32_t index, int cell);
+  void unlink(uint32_t index);
+};
+
+} /* namespace rayc */
+
+#endif /* _RAYC_SPATIAL_H_ */
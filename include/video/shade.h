@@ -0,0 +1,51 @@
+#ifndef _RAYC_VIDEO_SHADE_H_
+#define _RAYC_VIDEO_SHADE_H_ 1
+
+#include <cstdint>
+
+#include <rayc/map.h>
+
+namespace rayc {
+
+// Color mod for the texture and alpha of the fog color drawn over it
+struct Shade {
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+  uint8_t fog;
+};
+
+// One ramp per light level over quantized distance, rebuilt only when the fog changes
+class ShadeTable {
+ public:
+  static const int LIGHT_LEVELS = 32;
+  static const int DISTANCE_STEPS = 64;
+
+ private:
+  MapFog m_fog;
+  float m_distanceScale = 0.0f;
+  Shade m_shades[LIGHT_LEVELS * DISTANCE_STEPS];
+
+ public:
+  ShadeTable();
+
+  void build(const MapFog& fog);
+
+  inline const Shade& lookup(float distance, uint8_t light) const {
+    int step = distance * m_distanceScale;
+    step = step < 0 ? 0 : (step >= DISTANCE_STEPS ? DISTANCE_STEPS - 1 : step);
+    return m_shades[(light * LIGHT_LEVELS >> 8) * DISTANCE_STEPS + step];
+  }
+
+  // Sprites can't take the overlay, the fog is folded into their color mod instead
+  uint8_t lookupDimmed(float distance, uint8_t light) const;
+
+  // Nothing past this is visible, rays can stop there
+  float getCutoff(float maxDistance) const;
+  bool hasOverlay() const;
+  const MapFog& getFog() const;
+};
+
+} /* namespace rayc */
+
+#endif /* _RAYC_VIDEO_SHADE_H_ */
@@ -0,0 +1,58 @@
+#ifndef _RAYC_VIDEO_SPRITE_H_
+#define _RAYC_VIDEO_SPRITE_H_ 1
+
+#include <vector>
+#include <cstdint>
+
+namespace rayc {
+
+struct SpriteInstance {
+  float depth = 0.0f;
+  uint16_t depthKey = 0;
+  uint16_t sprite = 0;
+  uint8_t light = 255;
+  uint32_t object = 0; // slot of the object it was made for
+
+  // Unclipped screen rectangle
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+
+  // Visible column range after clipping to the screen, [left, right)
+  int left = 0;
+  int right = 0;
+};
+
+// Per-block min/max of the wall depth buffer, rebuilt once per frame after the wall pass
+class DepthSummary {
+ public:
+  static const int BLOCK_SIZE = 16;
+
+ private:
+  const float* m_depth = nullptr;
+  int m_width = 0;
+  std::vector<float> m_min;
+  std::vector<float> m_max;
+
+ public:
+  DepthSummary() = default;
+
+  void build(const float* depth, int width);
+
+  // Conservative over [from, to): min/max of every block the range touches
+  float getMinDepth(int from, int to) const;
+  float getMaxDepth(int from, int to) const;
+
+  // Every wall column in [from, to) is closer than depth
+  bool isOccluded(int from, int to, float depth) const;
+  // No wall column in [from, to) is closer than depth
+  bool isUnoccluded(int from, int to, float depth) const;
+};
+
+// Quantizes depth into depthKey and radix sorts far to near, scratch is reused between frames
+void sortSpritesBackToFront(std::vector<SpriteInstance>& sprites, std::vector<SpriteInstance>& scratch, float maxDepth);
+
+} /* namespace rayc */
+
+#endif /* _RAYC_VIDEO_SPRITE_H_ */
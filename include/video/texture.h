@@ -2,21 +2,42 @@
 #define _RAYC_VIDEO_TEXTURE_H_ 1
 
 #include <string>
+#include <vector>
+#include <cstdint>
 #include <SDL2/SDL.h>
 
 namespace rayc {
 
+enum TextureFlags {
+  TEXTURE_OPAQUE_SPANS = 0x1,
+  TEXTURE_KEEP_PIXELS  = 0x2, // CPU copy for software passes
+  TEXTURE_STREAMING    = 0x4, // rewritten from the CPU every frame
+};
+
+// Run of non-transparent texels in one texture column, [start, end)
+struct TextureSpan {
+  uint16_t start;
+  uint16_t end;
+};
+
 class Texture {
  private:
   std::string m_filename;
   SDL_Texture* m_texture = nullptr;
   int m_width = 0;
   int m_height = 0;
+  uint32_t m_colorMod = 0xffffff;
+
+  // Spans of column x are m_spans[m_spanOffsets[x]] .. m_spans[m_spanOffsets[x+1]]
+  std::vector<TextureSpan> m_spans;
+  std::vector<uint32_t> m_spanOffsets;
+
+  std::vector<uint32_t> m_pixels; // RGBA8888, row by row
 
  public:
   Texture();
-  Texture(const std::string& filename);
-  Texture(int w, int h);
+  Texture(const std::string& filename, int flags = 0);
+  Texture(int w, int h, int flags = 0);
   Texture(const Texture& rhs) = delete;
   Texture(Texture&& rhs);
   ~Texture();
@@ -29,6 +50,24 @@ class Texture {
 
   int getWidth() const;
   int getHeight() const;
+
+  // Multiplies every texel on the next copies, skips the SDL call when nothing changed
+  void setColorMod(uint8_t r, uint8_t g, uint8_t b);
+
+  // Only with TEXTURE_KEEP_PIXELS, nullptr otherwise
+  const uint32_t* getPixels() const;
+  // Streaming textures only, pixels are RGBA8888 and cover the whole texture
+  void update(const uint32_t* pixels);
+  // Only area, pixels starts at its top left corner and rows are pitch pixels apart
+  void update(const uint32_t* pixels, const SDL_Rect& area, int pitch);
+
+  bool hasSpans() const;
+  const TextureSpan* getSpans(int column) const;
+  int getSpanCount(int column) const;
+
+ private:
+  void buildSpans(SDL_Surface* surface);
+  void copyPixels(SDL_Surface* surface);
 };
 
 } /* namespace rayc */
@@ -0,0 +1,22 @@
+#ifndef _RAYC_VISIBILITY_H_
+#define _RAYC_VISIBILITY_H_ 1
+
+#include <rayc/map.h>
+
+namespace rayc {
+
+const int VISIBILITY_CLUSTER_SIZE = 8;
+// Rays per sample point grow with the map diagonal so neighbouring rays stay half a tile apart
+// across it, between these bounds
+const int VISIBILITY_MIN_RAYS = 256;
+const int VISIBILITY_MAX_RAYS = 4096;
+
+// Fills map.visibility by casting rays from points in every open tile, doors count as open and
+// see-through tiles don't stop the rays. Offline step, slow on large maps.
+// Sampled, not conservative: past about VISIBILITY_MAX_RAYS / (2 * pi) tiles (~650) a one tile
+// opening can still fall between two rays, and whatever is only seen through it pops out of view
+void buildVisibility(Map& map, int clusterSize = VISIBILITY_CLUSTER_SIZE);
+
+} /* namespace rayc */
+
+#endif /* _RAYC_VISIBILITY_H_ */
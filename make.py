@@ -8,6 +8,10 @@ def features(profile, feature_list):
     if profile == 'debug':
         build.config.get('cpp', 'cxxflags').extend(['-g3', '-D_DEBUG'])
         # if 'MEM' in feature_list: build.config.get('cpp', 'cxxflags').append('-D_FF_MEMORY_DEBUG')
+    if 'FIXED_RAYS' in feature_list:
+        build.config.get('cpp', 'cxxflags').append('-DRAYC_FIXED_POINT_RAYS')
+    if 'AVX' in feature_list:
+        build.config.get('cpp', 'cxxflags').append('-mavx')
 
 @build.task()
 def install_headers(ctx):
@@ -23,7 +27,7 @@ def rayc(ctx):
     build.cpp.link_exe(
        files=[cf('{build_dir}/{profile}/obj/rayc.o')],
        output='rayc',
-       libs=['rayc', 'sdl2', 'sdl2_image', 'sdl2_ttf']
+       libs=['rayc', 'sdl2', 'sdl2_image', 'sdl2_ttf', 'pthread']
     )
 
 @build.task(['librayc'])
@@ -32,7 +36,34 @@ def map_tool(ctx):
     build.cpp.link_exe(
        files=[cf('{build_dir}/{profile}/obj/map_tool.o')],
        output='map_tool',
-       libs=['rayc', 'sdl2']
+       libs=['rayc', 'sdl2', 'pthread']
+    )
+
+@build.task(['librayc'])
+def nav_bench(ctx):
+    build.cpp.compile(cf('{topdir}/src/nav_bench.cc'), cxxflags='-O2')
+    build.cpp.link_exe(
+       files=[cf('{build_dir}/{profile}/obj/nav_bench.o')],
+       output='nav_bench',
+       libs=['rayc', 'sdl2', 'pthread']
+    )
+
+@build.task(['librayc'])
+def render_conformance(ctx):
+    build.cpp.compile(cf('{topdir}/src/render_conformance.cc'), cxxflags='-O2')
+    build.cpp.link_exe(
+       files=[cf('{build_dir}/{profile}/obj/render_conformance.o')],
+       output='render_conformance',
+       libs=['rayc', 'sdl2', 'pthread']
+    )
+
+@build.task(['librayc'])
+def rayc_microbench(ctx):
+    build.cpp.compile(cf('{topdir}/src/microbench.cc'), cxxflags='-O2')
+    build.cpp.link_exe(
+       files=[cf('{build_dir}/{profile}/obj/microbench.o')],
+       output='rayc_microbench',
+       libs=['rayc', 'sdl2', 'sdl2_image', 'sdl2_ttf', 'pthread']
     )
 
 @build.task(['install_headers'])
@@ -42,13 +73,24 @@ def librayc(ctx):
         cf('{topdir}/src/log.cc'),
         cf('{topdir}/src/map.cc'),
         cf('{topdir}/src/data.cc'),
+        cf('{topdir}/src/door.cc'),
+        cf('{topdir}/src/jobs.cc'),
+        cf('{topdir}/src/light.cc'),
+        cf('{topdir}/src/nav.cc'),
         cf('{topdir}/src/object.cc'),
+        cf('{topdir}/src/raycast.cc'),
+        cf('{topdir}/src/reference.cc'),
         cf('{topdir}/src/config.cc'),
+        cf('{topdir}/src/spatial.cc'),
+        cf('{topdir}/src/visibility.cc'),
         cf('{topdir}/src/intutils.cc'),
         cf('{topdir}/src/strutils.cc'),
         cf('{topdir}/src/math/rect.cc'),
+        cf('{topdir}/src/math/batch.cc'),
         cf('{topdir}/src/video/draw.cc'),
         cf('{topdir}/src/video/font.cc'),
+        cf('{topdir}/src/video/shade.cc'),
+        cf('{topdir}/src/video/sprite.cc'),
         cf('{topdir}/src/video/texture.cc')
     ], 'rayc')
     build.cpp.create_static_lib(
@@ -1,5 +1,6 @@
 #include <rayc/app.h>
 #include <rayc/log.h>
+#include <rayc/jobs.h>
 #include <rayc/version.h>
 #include <rayc/math/rect.h>
 #include <rayc/video/font.h>
@@ -245,6 +246,8 @@ void rayc::run(UpdaterCb cb, ConsoleCommandCb commandCb) {
       }
     }
 
+    jobs::processMainThreadQueue();
+
     clearBuffer();
 
     state.isRunning = cb(actualFrameTime);
@@ -277,6 +280,7 @@ void rayc::run(UpdaterCb cb, ConsoleCommandCb commandCb) {
 }
 
 [[noreturn]] void rayc::die(int exitCode) {
+  jobs::shutdown();
   shutdown();
   exit(exitCode);
 }
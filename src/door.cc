@@ -0,0 +1,132 @@
+#include <rayc/door.h>
+
+#include <algorithm>
+
+void rayc::DoorSystem::reset(const Map& map) {
+  m_active.clear();
+  m_events.clear();
+  m_moving = 0;
+
+  // Doors saved mid-way or open carry on from where they are
+  for (int y = 0; y < map.height; y++) {
+    for (int x = 0; x < map.width; x++) {
+      const MapTile& tile = map.getTile(x, y);
+      if (tile.isDoor() && tile.doorState != DOOR_CLOSED) {
+        track({x, y}, tile);
+      }
+    }
+  }
+}
+
+bool rayc::DoorSystem::open(Map& map, Vec2i position) {
+  if (!map.contains(position) || !map.getTile(position).isDoor()) {
+    return false;
+  }
+
+  MapTile& tile = map.getTile(position);
+
+  switch (tile.doorState) {
+    case DOOR_CLOSED:
+    case DOOR_CLOSING:
+      track(position, tile);
+      setState(tile, position, DOOR_OPENING);
+      break;
+    case DOOR_OPENED:
+      track(position, tile).timer = 0.0f;
+      break;
+    case DOOR_OPENING:
+      track(position, tile);
+      break;
+  }
+
+  return true;
+}
+
+void rayc::DoorSystem::close(Map& map, Vec2i position) {
+  if (!map.contains(position) || !map.getTile(position).isDoor()) {
+    return;
+  }
+
+  MapTile& tile = map.getTile(position);
+  if (tile.doorState == DOOR_OPENING || tile.doorState == DOOR_OPENED) {
+    track(position, tile);
+    setState(tile, position, DOOR_CLOSING);
+  }
+}
+
+void rayc::DoorSystem::update(Map& map, float frameTime, const std::function<bool(Vec2i)>& isOccupied) {
+  float step = frameTime / DOOR_OPEN_TIME;
+  m_moving = 0;
+
+  for (size_t i = 0; i < m_active.size();) {
+    ActiveDoor& door = m_active[i];
+    MapTile& tile = map.getTile(door.tile);
+
+    if (tile.doorState == DOOR_OPENING || tile.doorState == DOOR_CLOSING) {
+      m_moving++;
+    }
+
+    if (tile.doorState == DOOR_OPENING) {
+      door.opened = std::min(door.opened + step, 1.0f);
+      if (door.opened >= 1.0f) {
+        door.timer = 0.0f;
+        tile.framesSinceOpened = 0;
+        setState(tile, door.tile, DOOR_OPENED);
+      }
+    } else if (tile.doorState == DOOR_OPENED) {
+      door.timer += frameTime;
+      tile.framesSinceOpened++;
+      if (door.timer >= DOOR_HOLD_TIME && !(isOccupied && isOccupied(door.tile))) {
+        setState(tile, door.tile, DOOR_CLOSING);
+      }
+    } else if (tile.doorState == DOOR_CLOSING) {
+      door.opened = std::max(door.opened - step, 0.0f);
+      if (door.opened <= 0.0f) {
+        setState(tile, door.tile, DOOR_CLOSED);
+      }
+    }
+
+    tile.openedPercent = door.opened * 100.0f;
+
+    if (tile.doorState == DOOR_CLOSED) {
+      m_active[i] = m_active.back();
+      m_active.pop_back();
+    } else {
+      i++;
+    }
+  }
+}
+
+const std::vector<rayc::DoorEvent>& rayc::DoorSystem::getEvents() const {
+  return m_events;
+}
+
+void rayc::DoorSystem::clearEvents() {
+  m_events.clear();
+}
+
+size_t rayc::DoorSystem::getActiveCount() const {
+  return m_active.size();
+}
+
+size_t rayc::DoorSystem::getMovingCount() const {
+  return m_moving;
+}
+
+// The door's entry in the active list, added from its current opening when it isn't there yet
+rayc::DoorSystem::ActiveDoor& rayc::DoorSystem::track(Vec2i position, const MapTile& tile) {
+  for (auto& door : m_active) {
+    if (door.tile == position) {
+      return door;
+    }
+  }
+
+  float opened = tile.doorState == DOOR_OPENED ? 1.0f : tile.openedPercent / 100.0f;
+  m_active.push_back({position, opened, 0.0f});
+  return m_active.back();
+}
+
+void rayc::DoorSystem::setState(MapTile& tile, Vec2i position, DoorState state) {
+  tile.doorState = state;
+  m_events.push_back({position, state});
+}
@@ -0,0 +1,308 @@
+#include <rayc/jobs.h>
+#include <rayc/log.h>
+
+#include <deque>
+#include <thread>
+#include <algorithm>
+#include <condition_variable>
+
+using namespace rayc;
+using namespace rayc::jobs;
+
+struct JobWorker {
+  std::mutex mutex;
+  std::deque<JobHandle> jobs;
+  std::thread thread;
+};
+
+struct JobSystemState {
+  bool isInitialized = false;
+  std::atomic<bool> isRunning {false};
+
+  std::vector<std::unique_ptr<JobWorker>> workers;
+  std::atomic<unsigned> nextWorker {0};
+  std::atomic<int> queued {0};
+
+  std::mutex sleepMutex;
+  std::condition_variable sleepCondition;
+
+  std::mutex mainThreadMutex;
+  std::vector<JobFn> mainThreadQueue;
+
+  std::thread::id mainThreadId = std::this_thread::get_id();
+};
+
+static JobSystemState state;
+static thread_local int workerIndex = -1;
+
+static void runJob(JobHandle job);
+
+
+static void schedule(JobHandle job) {
+  if (state.workers.empty()) {
+    runJob(std::move(job));
+    return;
+  }
+
+  JobWorker* worker = nullptr;
+  if (workerIndex >= 0) {
+    worker = state.workers[workerIndex].get();
+  } else {
+    worker = state.workers[state.nextWorker++ % state.workers.size()].get();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    worker->jobs.push_back(std::move(job));
+  }
+
+  state.queued++;
+  {
+    std::lock_guard<std::mutex> lock(state.sleepMutex);
+  }
+  state.sleepCondition.notify_one();
+}
+
+static void finish(JobHandle& job) {
+  std::vector<JobHandle> continuations;
+  {
+    std::lock_guard<std::mutex> lock(job->mutex);
+    job->finished = true;
+    continuations.swap(job->continuations);
+  }
+
+  for (auto& continuation : continuations) {
+    if (--continuation->pendingDependencies == 0) {
+      schedule(std::move(continuation));
+    }
+  }
+}
+
+static void runJob(JobHandle job) {
+  job->fn();
+  job->fn = nullptr;
+  finish(job);
+}
+
+// Own deque is LIFO for locality, others are robbed from the front
+static JobHandle findJob() {
+  if (workerIndex >= 0) {
+    JobWorker* own = state.workers[workerIndex].get();
+    std::lock_guard<std::mutex> lock(own->mutex);
+    if (!own->jobs.empty()) {
+      JobHandle job = std::move(own->jobs.back());
+      own->jobs.pop_back();
+      state.queued--;
+      return job;
+    }
+  }
+
+  size_t count = state.workers.size();
+  size_t first = workerIndex >= 0 ? workerIndex + 1 : state.nextWorker.load();
+  for (size_t i = 0; i < count; i++) {
+    JobWorker* victim = state.workers[(first + i) % count].get();
+    std::lock_guard<std::mutex> lock(victim->mutex);
+    if (!victim->jobs.empty()) {
+      JobHandle job = std::move(victim->jobs.front());
+      victim->jobs.pop_front();
+      state.queued--;
+      return job;
+    }
+  }
+
+  return nullptr;
+}
+
+static void workerLoop(int index) {
+  workerIndex = index;
+
+  while (state.isRunning) {
+    JobHandle job = findJob();
+    if (job) {
+      runJob(std::move(job));
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(state.sleepMutex);
+    state.sleepCondition.wait(lock, []() { return state.queued > 0 || !state.isRunning; });
+  }
+}
+
+static JobHandle makeJob(JobFn fn) {
+  JobHandle job = std::make_shared<Job>();
+  job->fn = std::move(fn);
+  return job;
+}
+
+static void addDependency(JobHandle& job, const JobHandle& dependency) {
+  if (!dependency) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(dependency->mutex);
+  if (!dependency->finished) {
+    job->pendingDependencies++;
+    dependency->continuations.push_back(job);
+  }
+}
+
+static void release(JobHandle& job) {
+  if (--job->pendingDependencies == 0) {
+    schedule(job);
+  }
+}
+
+
+void rayc::jobs::init(int workerCount) {
+  if (state.isInitialized) {
+    return;
+  }
+
+  if (workerCount < 0) {
+    workerCount = std::max<int>(std::thread::hardware_concurrency() - 1, 0);
+  }
+
+  state.mainThreadId = std::this_thread::get_id();
+  state.isRunning = true;
+
+  for (int i = 0; i < workerCount; i++) {
+    state.workers.push_back(std::make_unique<JobWorker>());
+  }
+
+  for (int i = 0; i < workerCount; i++) {
+    state.workers[i]->thread = std::thread(workerLoop, i);
+  }
+
+  info("Job system started with %d worker(s)", workerCount);
+  state.isInitialized = true;
+}
+
+void rayc::jobs::shutdown() {
+  if (!state.isInitialized) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(state.sleepMutex);
+    state.isRunning = false;
+  }
+  state.sleepCondition.notify_all();
+
+  // die() can be reached from inside a job, a worker can't join itself
+  for (auto& worker : state.workers) {
+    if (worker->thread.get_id() == std::this_thread::get_id()) {
+      worker->thread.detach();
+    } else {
+      worker->thread.join();
+    }
+  }
+
+  // Whatever is still queued runs here, so nobody waits forever on a dropped job
+  while (JobHandle job = findJob()) {
+    runJob(std::move(job));
+  }
+
+  state.workers.clear();
+  state.queued = 0;
+  state.isInitialized = false;
+}
+
+int rayc::jobs::getWorkerCount() {
+  return state.workers.size();
+}
+
+bool rayc::jobs::isMainThread() {
+  return std::this_thread::get_id() == state.mainThreadId;
+}
+
+JobHandle rayc::jobs::submit(JobFn fn) {
+  JobHandle job = makeJob(std::move(fn));
+  release(job);
+  return job;
+}
+
+JobHandle rayc::jobs::submit(JobFn fn, std::initializer_list<JobHandle> dependencies) {
+  JobHandle job = makeJob(std::move(fn));
+  for (auto& dependency : dependencies) {
+    addDependency(job, dependency);
+  }
+  release(job);
+  return job;
+}
+
+JobHandle rayc::jobs::submit(JobFn fn, const std::vector<JobHandle>& dependencies) {
+  JobHandle job = makeJob(std::move(fn));
+  for (auto& dependency : dependencies) {
+    addDependency(job, dependency);
+  }
+  release(job);
+  return job;
+}
+
+JobHandle rayc::jobs::then(JobHandle job, JobFn fn) {
+  return submit(std::move(fn), {job});
+}
+
+void rayc::jobs::wait(JobHandle job) {
+  while (job && !job->finished) {
+    JobHandle other = findJob();
+    if (other) {
+      runJob(std::move(other));
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void rayc::jobs::waitAll(const std::vector<JobHandle>& jobs) {
+  for (auto& job : jobs) {
+    wait(job);
+  }
+}
+
+void rayc::jobs::parallelFor(int begin, int end, int grainSize, RangeFn fn) {
+  if (end <= begin) {
+    return;
+  }
+
+  grainSize = std::max(grainSize, 1);
+
+  if (state.workers.empty() || end - begin <= grainSize) {
+    fn(begin, end);
+    return;
+  }
+
+  std::vector<JobHandle> chunks;
+  chunks.reserve((end - begin) / grainSize + 1);
+
+  // The caller takes the first chunk itself instead of idling in wait()
+  for (int from = begin + grainSize; from < end; from += grainSize) {
+    int to = std::min(from + grainSize, end);
+    chunks.push_back(submit([&fn, from, to]() { fn(from, to); }));
+  }
+
+  fn(begin, std::min(begin + grainSize, end));
+  waitAll(chunks);
+}
+
+void rayc::jobs::runOnMainThread(JobFn fn) {
+  if (isMainThread()) {
+    fn();
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(state.mainThreadMutex);
+  state.mainThreadQueue.push_back(std::move(fn));
+}
+
+void rayc::jobs::processMainThreadQueue() {
+  std::vector<JobFn> queue;
+  {
+    std::lock_guard<std::mutex> lock(state.mainThreadMutex);
+    queue.swap(state.mainThreadQueue);
+  }
+
+  for (auto& fn : queue) {
+    fn();
+  }
+}
@@ -0,0 +1,396 @@
+#include <rayc/light.h>
+#include <rayc/raycast.h>
+#include <rayc/jobs.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+// Positions along a face the bake averages over, keeps shadow edges from snapping to whole tiles
+static const double FACE_SAMPLES[] = {-0.3, 0.0, 0.3};
+
+rayc::Vec2d rayc::getFaceNormal(TileSide side) {
+  switch (side) {
+    case SIDE_NORTH: return {0, -1};
+    case SIDE_SOUTH: return {0, 1};
+    case SIDE_WEST:  return {-1, 0};
+    case SIDE_EAST:  return {1, 0};
+  }
+  return {0, 0};
+}
+
+rayc::Vec2d rayc::getFaceCenter(Vec2i tile, TileSide side) {
+  return Vec2d(tile.x + 0.5, tile.y + 0.5) + getFaceNormal(side) * 0.5;
+}
+
+uint8_t rayc::sampleStaticLight(const Map& map, Vec2d point, Vec2d normal) {
+  double total = map.ambientLight;
+
+  for (auto& light : map.lights) {
+    Vec2d toLight = Vec2d(light.x + 0.5, light.y + 0.5) - point;
+    double distance = std::sqrt(toLight.dot(toLight));
+
+    if (distance >= light.radius) {
+      continue;
+    }
+
+    bool omnidirectional = normal.x == 0 && normal.y == 0;
+    double facing = distance > 0 && !omnidirectional ? normal.dot(toLight) / distance : 1.0;
+    if (facing <= 0) {
+      continue;
+    }
+
+    // Doors are ignored, a room shouldn't stay dark after its door opens
+    if (!hasLineOfSight(map, point, point + toLight, RAY_IGNORE_DOORS)) {
+      continue;
+    }
+
+    double falloff = 1.0 - distance / light.radius;
+    total += light.intensity * falloff * falloff * facing;
+  }
+
+  return (uint8_t)std::min(total, 255.0);
+}
+
+void rayc::bakeLightmap(Map& map) {
+  map.lightmap.assign((size_t)map.width * map.height * 4, 0);
+  bakeLightmap(map, {{0, 0}, {map.width, map.height}});
+}
+
+void rayc::bakeLightmap(Map& map, const MapRegion& region) {
+  if (region.isEmpty() || !map.hasLightmap()) {
+    return;
+  }
+
+  jobs::parallelFor(region.from.y, region.to.y, 4, [&map, &region](int from, int to) {
+    for (int y = from; y < to; y++) {
+      for (int x = region.from.x; x < region.to.x; x++) {
+        for (int side = SIDE_NORTH; side <= SIDE_EAST; side++) {
+          map.lightmap[(map.width * y + x) * 4 + side] = 0;
+        }
+
+        if (!map.getTile(x, y).isSolid()) {
+          continue;
+        }
+
+        for (int side = SIDE_NORTH; side <= SIDE_EAST; side++) {
+          Vec2d normal = getFaceNormal((TileSide)side);
+          Vec2i neighbour = {x + (int)normal.x, y + (int)normal.y};
+
+          if (!map.contains(neighbour) || map.getTile(neighbour).isSolid()) {
+            continue;
+          }
+
+          // Nudged off the face so the sight rays don't start inside the wall
+          Vec2d center = getFaceCenter({x, y}, (TileSide)side) + normal * 0.01;
+          Vec2d along = {-normal.y, normal.x};
+
+          int sum = 0;
+          for (double offset : FACE_SAMPLES) {
+            sum += sampleStaticLight(map, center + along * offset, normal);
+          }
+
+          map.lightmap[(map.width * y + x) * 4 + side] = sum / (int)(sizeof(FACE_SAMPLES) / sizeof(FACE_SAMPLES[0]));
+        }
+      }
+    }
+  });
+}
+
+rayc::MapRegion rayc::getStaticLightReach(const Map& map, Vec2i tile) {
+  MapRegion reach;
+
+  for (auto& light : map.lights) {
+    int dx = std::abs(tile.x - light.x), dy = std::abs(tile.y - light.y);
+    if (dx > light.radius + 1 || dy > light.radius + 1) {
+      continue;
+    }
+
+    // One more tile around the lit area, the faces of the walls bordering it are lit too
+    int radius = light.radius + 1;
+    MapRegion lit = {
+      {std::max(light.x - radius, 0), std::max(light.y - radius, 0)},
+      {std::min(light.x + radius + 1, (int)map.width), std::min(light.y + radius + 1, (int)map.height)},
+    };
+    reach.include(lit);
+  }
+
+  return reach;
+}
+
+void rayc::LightGrid::reset(const Map& map) {
+  m_map = &map;
+  m_freeLights.clear();
+  m_dirtyLights.clear();
+
+  // Handles from the previous map go stale instead of pointing at new lights
+  for (uint32_t i = 0; i < m_lights.size(); i++) {
+    Light& light = m_lights[i];
+    light.generation++;
+    light.alive = false;
+    light.dirty = false;
+    light.footprint.clear();
+    m_freeLights.push_back(i);
+  }
+
+  size_t size = (size_t)map.width * map.height;
+  m_dynamic.assign(size, 0);
+  m_static.assign(size, map.ambientLight);
+
+  if (map.lights.empty()) {
+    return;
+  }
+
+  jobs::parallelFor(0, map.height, 4, [this, &map](int from, int to) {
+    for (int y = from; y < to; y++) {
+      for (int x = 0; x < map.width; x++) {
+        if (!map.getTile(x, y).isSolid()) {
+          m_static[map.width * y + x] = sampleStaticLight(map, {x + 0.5, y + 0.5}, {0, 0});
+        }
+      }
+    }
+  });
+}
+
+rayc::LightHandle rayc::LightGrid::add(Vec2d position, float intensity, float radius) {
+  uint32_t index;
+  if (!m_freeLights.empty()) {
+    index = m_freeLights.back();
+    m_freeLights.pop_back();
+  } else {
+    index = m_lights.size();
+    m_lights.push_back({});
+  }
+
+  Light& light = m_lights[index];
+  light.position = position;
+  light.intensity = intensity;
+  light.radius = radius;
+  light.alive = true;
+  light.footprint.clear();
+
+  markDirty(index);
+  return {index, light.generation};
+}
+
+void rayc::LightGrid::move(LightHandle handle, Vec2d position) {
+  if (!isAlive(handle)) {
+    return;
+  }
+
+  // Moves inside a tile aren't retraced, the footprint only has tile resolution anyway
+  Light& light = m_lights[handle.index];
+  Vec2i from = {(int)std::floor(light.position.x), (int)std::floor(light.position.y)};
+  Vec2i to = {(int)std::floor(position.x), (int)std::floor(position.y)};
+  light.position = position;
+
+  if (from != to || light.footprint.empty()) {
+    markDirty(handle.index);
+  }
+}
+
+void rayc::LightGrid::setIntensity(LightHandle handle, float intensity) {
+  if (!isAlive(handle) || m_lights[handle.index].intensity == intensity) {
+    return;
+  }
+
+  m_lights[handle.index].intensity = intensity;
+  markDirty(handle.index);
+}
+
+void rayc::LightGrid::remove(LightHandle handle) {
+  if (!isAlive(handle)) {
+    return;
+  }
+
+  Light& light = m_lights[handle.index];
+  applyFootprint(light, -1);
+  light.footprint.clear();
+  light.alive = false;
+  light.generation++;
+
+  m_freeLights.push_back(handle.index);
+}
+
+bool rayc::LightGrid::isAlive(LightHandle handle) const {
+  return handle.index < m_lights.size()
+    && m_lights[handle.index].alive
+    && m_lights[handle.index].generation == handle.generation;
+}
+
+void rayc::LightGrid::invalidateTile(Vec2i tile) {
+  Vec2d center = {tile.x + 0.5, tile.y + 0.5};
+
+  for (uint32_t i = 0; i < m_lights.size(); i++) {
+    const Light& light = m_lights[i];
+    if (!light.alive) {
+      continue;
+    }
+
+    // A tile blocks rays to anything behind it, so the whole reach counts, not just the tile itself
+    Vec2d delta = center - light.position;
+    double reach = light.radius + 1.0;
+    if (delta.dot(delta) < reach * reach) {
+      markDirty(i);
+    }
+  }
+}
+
+void rayc::LightGrid::resampleStatic(const MapRegion& region) {
+  if (!m_map || region.isEmpty()) {
+    return;
+  }
+
+  const Map& map = *m_map;
+  for (int y = region.from.y; y < region.to.y; y++) {
+    for (int x = region.from.x; x < region.to.x; x++) {
+      m_static[map.width * y + x] = map.getTile(x, y).isSolid() ? map.ambientLight : sampleStaticLight(map, {x + 0.5, y + 0.5}, {0, 0});
+    }
+  }
+}
+
+int rayc::LightGrid::update(Vec2i viewer) {
+  if (!m_map) {
+    return 0;
+  }
+
+  // Lights removed after being marked are skipped, their slot may even be reused by now
+  std::vector<uint32_t> dirty;
+  dirty.swap(m_dirtyLights);
+
+  int viewerCluster = m_map->visibility.getCluster(viewer);
+  if (viewerCluster >= 0) {
+    size_t kept = 0;
+    for (uint32_t index : dirty) {
+      if (m_lights[index].alive && !isInView(m_lights[index], viewerCluster)) {
+        m_dirtyLights.push_back(index);
+      } else {
+        dirty[kept++] = index;
+      }
+    }
+    dirty.resize(kept);
+  }
+
+  for (uint32_t index : dirty) {
+    Light& light = m_lights[index];
+    light.dirty = false;
+    if (light.alive) {
+      applyFootprint(light, -1);
+    }
+  }
+
+  // Tracing only reads the map, the sums are updated afterwards on this thread
+  jobs::parallelFor(0, (int)dirty.size(), 4, [this, &dirty](int from, int to) {
+    for (int i = from; i < to; i++) {
+      Light& light = m_lights[dirty[i]];
+      if (light.alive) {
+        traceFootprint(light);
+      }
+    }
+  });
+
+  for (uint32_t index : dirty) {
+    if (m_lights[index].alive) {
+      applyFootprint(m_lights[index], 1);
+    }
+  }
+
+  return dirty.size();
+}
+
+uint8_t rayc::LightGrid::getLight(Vec2i tile) const {
+  if (!m_map || !m_map->contains(tile)) {
+    return 255;
+  }
+
+  int offset = m_map->width * tile.y + tile.x;
+  return std::min(m_static[offset] + m_dynamic[offset], 255);
+}
+
+uint8_t rayc::LightGrid::getDynamicLight(Vec2i tile) const {
+  if (!m_map || !m_map->contains(tile)) {
+    return 0;
+  }
+
+  return std::min(m_dynamic[m_map->width * tile.y + tile.x], 255);
+}
+
+uint8_t rayc::LightGrid::getFaceLight(Vec2i tile, TileSide side) const {
+  if (!m_map) {
+    return 255;
+  }
+
+  Vec2d normal = getFaceNormal(side);
+  Vec2i front = {tile.x + (int)normal.x, tile.y + (int)normal.y};
+
+  // Without a baked lightmap the face reads the tile in front of it, same as floors and sprites
+  if (!m_map->hasLightmap()) {
+    return getLight(front);
+  }
+
+  return std::min(m_map->getLight(tile, side) + getDynamicLight(front), 255);
+}
+
+bool rayc::LightGrid::isInView(const Light& light, int viewerCluster) const {
+  const MapVisibility& visibility = m_map->visibility;
+  int size = visibility.clusterSize;
+
+  int fromX = std::max((int)std::floor(light.position.x - light.radius) / size, 0);
+  int fromY = std::max((int)std::floor(light.position.y - light.radius) / size, 0);
+  int toX = std::min((int)std::floor(light.position.x + light.radius) / size, visibility.columns - 1);
+  int toY = std::min((int)std::floor(light.position.y + light.radius) / size, visibility.rows - 1);
+
+  for (int y = fromY; y <= toY; y++) {
+    for (int x = fromX; x <= toX; x++) {
+      if (visibility.canSeeCluster(viewerCluster, y * visibility.columns + x)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void rayc::LightGrid::markDirty(uint32_t index) {
+  if (!m_lights[index].dirty) {
+    m_lights[index].dirty = true;
+    m_dirtyLights.push_back(index);
+  }
+}
+
+void rayc::LightGrid::applyFootprint(const Light& light, int sign) {
+  for (auto& [offset, value] : light.footprint) {
+    m_dynamic[offset] += sign * value;
+  }
+}
+
+void rayc::LightGrid::traceFootprint(Light& light) const {
+  light.footprint.clear();
+
+  int reach = (int)std::ceil(light.radius);
+  Vec2i center = {(int)std::floor(light.position.x), (int)std::floor(light.position.y)};
+
+  for (int y = center.y - reach; y <= center.y + reach; y++) {
+    for (int x = center.x - reach; x <= center.x + reach; x++) {
+      if (!m_map->contains(x, y) || m_map->getTile(x, y).isSolid()) {
+        continue;
+      }
+
+      Vec2d tileCenter = {x + 0.5, y + 0.5};
+      Vec2d delta = tileCenter - light.position;
+      double distance = std::sqrt(delta.dot(delta));
+
+      if (distance >= light.radius) {
+        continue;
+      }
+
+      double falloff = 1.0 - distance / light.radius;
+      int value = light.intensity * falloff * falloff;
+
+      if (value <= 0 || !hasLineOfSight(*m_map, light.position, tileCenter)) {
+        continue;
+      }
+
+      light.footprint.push_back({m_map->width * y + x, value});
+    }
+  }
+}
@@ -8,6 +8,7 @@
 #include <cstdlib>
 #include <cstdio>
 #include <vector>
+#include <algorithm>
 
 template <typename T> void writeBinary(std::ostream& file, T& data) {
   file.write((char*)&data, sizeof(T));
@@ -17,6 +18,38 @@ template <typename T> void readBinary(std::istream& file, T* data) {
   file.read((char*)data, sizeof(T));
 }
 
+static void writeSection(std::ostream& file, uint16_t tag, const std::string& data) {
+  uint32_t size = data.size();
+  writeBinary(file, tag);
+  writeBinary(file, size);
+  file.write(data.data(), data.size());
+}
+
+// Lightmap faces and visibility bits are mostly runs of the same byte, stored as (count, value) pairs
+static std::string encodeRuns(const std::vector<uint8_t>& bytes) {
+  std::string data;
+  for (size_t i = 0; i < bytes.size();) {
+    uint8_t value = bytes[i];
+    uint8_t count = 0;
+    while (i < bytes.size() && bytes[i] == value && count < 255) {
+      count++;
+      i++;
+    }
+    data.push_back(count);
+    data.push_back(value);
+  }
+  return data;
+}
+
+static void decodeRuns(std::istream& file, uint32_t size, std::vector<uint8_t>& bytes) {
+  for (uint32_t i = 0; i + 1 < size; i += 2) {
+    uint8_t count = 0, value = 0;
+    readBinary(file, &count);
+    readBinary(file, &value);
+    bytes.insert(bytes.end(), count, value);
+  }
+}
+
 bool rayc::MapTile::isSolid() const {
   return texture != 0;
 }
@@ -33,6 +66,18 @@ bool rayc::MapTile::isHDoor() const {
   return flags & TILE_HDOOR;
 }
 
+bool rayc::MapTile::isSeeThrough() const {
+  return flags & TILE_SEETHROUGH;
+}
+
+bool rayc::MapTile::isPassable() const {
+  return !isSolid() || (isDoor() && doorState == DOOR_OPENED);
+}
+
+int rayc::MapTile::getWallHeight() const {
+  return height ? height : 1;
+}
+
 rayc::Map::Map() : Map(0, 0) {}
 
 rayc::Map::Map(int w, int h) : width(w), height(h), startPosition(0, 0) {
@@ -90,6 +135,54 @@ void rayc::Map::save(const std::string& filename) {
     writeBinary(file, tile.height);
   }
 
+  if (!lights.empty()) {
+    std::ostringstream section;
+    writeBinary(section, ambientLight);
+    for (auto& light : lights) {
+      writeBinary(section, light.x);
+      writeBinary(section, light.y);
+      writeBinary(section, light.intensity);
+      writeBinary(section, light.radius);
+    }
+    writeSection(file, MAP_SECTION_LIGHTS, section.str());
+  }
+
+  if (fog.enabled) {
+    std::ostringstream section;
+    writeBinary(section, fog.r);
+    writeBinary(section, fog.g);
+    writeBinary(section, fog.b);
+    writeBinary(section, fog.start);
+    writeBinary(section, fog.end);
+    writeSection(file, MAP_SECTION_FOG, section.str());
+  }
+
+  if (!sky.empty()) {
+    writeSection(file, MAP_SECTION_SKY, sky);
+  }
+
+  if (hasSurfaces()) {
+    std::ostringstream section;
+    for (auto& tile : tiles) {
+      writeBinary(section, tile.floorTexture);
+      writeBinary(section, tile.ceilingTexture);
+    }
+    writeSection(file, MAP_SECTION_SURFACES, section.str());
+  }
+
+  if (hasLightmap()) {
+    writeSection(file, MAP_SECTION_LIGHTMAP, encodeRuns(lightmap));
+  }
+
+  if (!visibility.isEmpty()) {
+    std::ostringstream section;
+    writeBinary(section, visibility.clusterSize);
+    writeBinary(section, visibility.columns);
+    writeBinary(section, visibility.rows);
+    section << encodeRuns(visibility.bits);
+    writeSection(file, MAP_SECTION_VISIBILITY, section.str());
+  }
+
   file.close();
 }
 
@@ -163,6 +256,63 @@ rayc::Map rayc::Map::load(const std::string& filename) {
     map.tiles.push_back(tile);
   }
 
+  // Maps written before sections existed simply end here
+  uint16_t tag = 0;
+  uint32_t size = 0;
+  while (readBinary(file, &tag), readBinary(file, &size), file.good()) {
+    std::streampos end = file.tellg() + (std::streamoff)size;
+
+    if (tag == MAP_SECTION_LIGHTS) {
+      readBinary(file, &map.ambientLight);
+      for (uint32_t i = 1; i + 6 <= size; i += 6) {
+        MapLight light;
+        readBinary(file, &light.x);
+        readBinary(file, &light.y);
+        readBinary(file, &light.intensity);
+        readBinary(file, &light.radius);
+        map.lights.push_back(light);
+      }
+    } else if (tag == MAP_SECTION_LIGHTMAP) {
+      decodeRuns(file, size, map.lightmap);
+      if (!map.hasLightmap()) {
+        error("Lightmap in '%s' doesn't match the map size, ignoring", filename.c_str());
+        map.lightmap.clear();
+      }
+    } else if (tag == MAP_SECTION_FOG) {
+      readBinary(file, &map.fog.r);
+      readBinary(file, &map.fog.g);
+      readBinary(file, &map.fog.b);
+      readBinary(file, &map.fog.start);
+      readBinary(file, &map.fog.end);
+      map.fog.enabled = true;
+    } else if (tag == MAP_SECTION_SKY) {
+      map.sky.resize(size);
+      file.read(&map.sky[0], size);
+    } else if (tag == MAP_SECTION_VISIBILITY) {
+      MapVisibility& visibility = map.visibility;
+      readBinary(file, &visibility.clusterSize);
+      readBinary(file, &visibility.columns);
+      readBinary(file, &visibility.rows);
+      decodeRuns(file, size >= 5 ? size - 5 : 0, visibility.bits);
+
+      int clusters = visibility.getClusterCount();
+      if (!visibility.clusterSize || visibility.columns != (map.width + visibility.clusterSize - 1) / visibility.clusterSize
+          || visibility.rows != (map.height + visibility.clusterSize - 1) / visibility.clusterSize
+          || visibility.bits.size() != ((size_t)clusters * clusters + 7) / 8) {
+        error("Visibility in '%s' doesn't match the map size, ignoring", filename.c_str());
+        visibility.clear();
+      }
+    } else if (tag == MAP_SECTION_SURFACES) {
+      for (uint32_t i = 0; i + 2 <= size && i / 2 < map.tiles.size(); i += 2) {
+        readBinary(file, &map.tiles[i / 2].floorTexture);
+        readBinary(file, &map.tiles[i / 2].ceilingTexture);
+      }
+    }
+
+    file.seekg(end);
+  }
+  file.clear(file.rdstate() & std::ios::badbit);
+
   map.isValid = true;
   if (file.bad()) {
     error("Error reading file '%s'", filename.c_str());
@@ -190,6 +340,19 @@ void rayc::Map::printInfo() const {
   for (int i = 0; i < sprites.size(); i++) {
     printf("  %d: %s\n", i, sprites[i].c_str());
   }
+  if (!sky.empty()) {
+    printf("sky:     %s\n", sky.c_str());
+  }
+  if (fog.enabled) {
+    printf("fog:     (%d, %d, %d) %.1f..%.1f\n", fog.r, fog.g, fog.b, fog.start, fog.end);
+  }
+  if (!visibility.isEmpty()) {
+    printf("pvs:     %dx%d clusters of %d tiles\n", visibility.columns, visibility.rows, visibility.clusterSize);
+  }
+  printf("lights:  ambient %d%s\n", ambientLight, hasLightmap() ? ", baked" : "");
+  for (auto& light : lights) {
+    printf("  (%d, %d): %d, radius %d\n", light.x, light.y, light.intensity, light.radius);
+  }
 }
 
 bool rayc::Map::valid() const {
@@ -207,3 +370,173 @@ rayc::MapTile& rayc::Map::getTile(int x, int y) {
 rayc::MapTile& rayc::Map::getTile(Vec2i pos) {
   return tiles[width * pos.y + pos.x];
 }
+
+const rayc::MapTile& rayc::Map::getTile(int offset) const {
+  return tiles[offset];
+}
+
+const rayc::MapTile& rayc::Map::getTile(int x, int y) const {
+  return tiles[width * y + x];
+}
+
+const rayc::MapTile& rayc::Map::getTile(Vec2i pos) const {
+  return tiles[width * pos.y + pos.x];
+}
+
+bool rayc::MapVisibility::isEmpty() const {
+  return bits.empty();
+}
+
+void rayc::MapVisibility::clear() {
+  clusterSize = 0;
+  columns = 0;
+  rows = 0;
+  bits.clear();
+}
+
+int rayc::MapVisibility::getClusterCount() const {
+  return columns * rows;
+}
+
+int rayc::MapVisibility::getCluster(Vec2i tile) const {
+  if (!clusterSize || tile.x < 0 || tile.y < 0) {
+    return -1;
+  }
+
+  int x = tile.x / clusterSize, y = tile.y / clusterSize;
+  if (x >= columns || y >= rows) {
+    return -1;
+  }
+  return y * columns + x;
+}
+
+bool rayc::MapVisibility::canSee(Vec2i from, Vec2i to) const {
+  if (isEmpty()) {
+    return true;
+  }
+  return canSeeCluster(getCluster(from), getCluster(to));
+}
+
+bool rayc::MapVisibility::canSeeCluster(int from, int to) const {
+  if (isEmpty() || from < 0 || to < 0) {
+    return true;
+  }
+
+  size_t bit = (size_t)from * getClusterCount() + to;
+  return bits[bit >> 3] & (1 << (bit & 7));
+}
+
+void rayc::MapVisibility::setVisible(int a, int b) {
+  size_t clusters = getClusterCount();
+  size_t forward = a * clusters + b, backward = b * clusters + a;
+  bits[forward >> 3] |= 1 << (forward & 7);
+  bits[backward >> 3] |= 1 << (backward & 7);
+}
+
+void rayc::MapVisibility::openCluster(int cluster) {
+  if (isEmpty() || cluster < 0) {
+    return;
+  }
+
+  // Any sightline through the new gap ends in two clusters that already saw the walls there
+  std::vector<int> seeing;
+  for (int i = 0; i < getClusterCount(); i++) {
+    if (canSeeCluster(cluster, i)) {
+      seeing.push_back(i);
+    }
+  }
+
+  for (size_t i = 0; i < seeing.size(); i++) {
+    for (size_t j = i; j < seeing.size(); j++) {
+      setVisible(seeing[i], seeing[j]);
+    }
+  }
+}
+
+bool rayc::MapRegion::isEmpty() const {
+  return from.x >= to.x || from.y >= to.y;
+}
+
+bool rayc::MapRegion::contains(Vec2i tile) const {
+  return tile.x >= from.x && tile.y >= from.y && tile.x < to.x && tile.y < to.y;
+}
+
+void rayc::MapRegion::include(Vec2i tile) {
+  include({tile, {tile.x + 1, tile.y + 1}});
+}
+
+void rayc::MapRegion::include(const MapRegion& region) {
+  if (region.isEmpty()) {
+    return;
+  }
+  if (isEmpty()) {
+    *this = region;
+    return;
+  }
+
+  from = {std::min(from.x, region.from.x), std::min(from.y, region.from.y)};
+  to = {std::max(to.x, region.to.x), std::max(to.y, region.to.y)};
+}
+
+bool rayc::Map::contains(int x, int y) const {
+  return x >= 0 && y >= 0 && x < width && y < height;
+}
+
+bool rayc::Map::contains(Vec2i pos) const {
+  return contains(pos.x, pos.y);
+}
+
+bool rayc::Map::hasSurfaces() const {
+  for (auto& tile : tiles) {
+    if (tile.floorTexture || tile.ceilingTexture) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool rayc::Map::hasLightmap() const {
+  return lightmap.size() == (size_t)width * height * 4;
+}
+
+uint8_t rayc::Map::getLight(Vec2i tile, TileSide side) const {
+  if (!hasLightmap()) {
+    return 255;
+  }
+  return lightmap[(width * tile.y + tile.x) * 4 + side];
+}
+
+void rayc::Map::setTile(Vec2i pos, const MapTile& tile) {
+  if (!contains(pos)) {
+    return;
+  }
+
+  getTile(pos) = tile;
+  markDirty(pos);
+}
+
+void rayc::Map::markDirty(Vec2i pos) {
+  if (!contains(pos)) {
+    return;
+  }
+
+  if (m_dirtyRegion.contains(pos) && std::find(m_changes.begin(), m_changes.end(), pos) != m_changes.end()) {
+    return;
+  }
+
+  m_changes.push_back(pos);
+  m_dirtyRegion.include(pos);
+}
+
+const std::vector<rayc::Vec2i>& rayc::Map::getChanges() const {
+  return m_changes;
+}
+
+const rayc::MapRegion& rayc::Map::getDirtyRegion() const {
+  return m_dirtyRegion;
+}
+
+void rayc::Map::clearChanges() {
+  m_changes.clear();
+  m_dirtyRegion = {};
+}
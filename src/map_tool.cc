@@ -1,4 +1,6 @@
 #include <rayc/map.h>
+#include <rayc/light.h>
+#include <rayc/visibility.h>
 #include <rayc/strutils.h>
 #include <rayc/log.h>
 
@@ -41,6 +43,12 @@ int main(int argc, char ** argv) {
   map.textures.push_back("wolf3d/WALL0.bmp");
   map.textures.push_back("wolf3d/WALL98.bmp");
 
+  map.ambientLight = 96;
+  map.lights.push_back({3, 3, 200, 6});
+  map.lights.push_back({7, 8, 160, 5});
+  rayc::bakeLightmap(map);
+  rayc::buildVisibility(map);
+
   if (argc == 3) {
     map.save(std::string(argv[2]));
   }
@@ -0,0 +1,86 @@
+#include <rayc/math/batch.h>
+#include <rayc/math/vec2x.h>
+
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const size_t WIDTH = rayc::Vec2fxN::WIDTH;
+
+void rayc::transformPoints(const Vec2d* points, size_t count, Vec2d origin, Vec2d forward, Vec2d right, float* depth, float* lateral) {
+  Vec2fxN from = Vec2f(origin);
+  Vec2fxN forwardx = Vec2f(forward);
+  Vec2fxN rightx = Vec2f(right);
+
+  size_t i = 0;
+  for (; i + WIDTH <= count; i += WIDTH) {
+    Vec2fxN relative = Vec2fxN::loadPoints(points + i) - from;
+    relative.dot(forwardx).store(depth + i);
+    relative.dot(rightx).store(lateral + i);
+  }
+
+  for (; i < count; i++) {
+    Vec2f relative = Vec2f(points[i]) - Vec2f(origin);
+    depth[i] = relative.dot(Vec2f(forward));
+    lateral[i] = relative.dot(Vec2f(right));
+  }
+}
+
+void rayc::dotBatch(const float* ax, const float* ay, const float* bx, const float* by, float* out, size_t count) {
+  size_t i = 0;
+  for (; i + WIDTH <= count; i += WIDTH) {
+    Vec2fxN::load(ax + i, ay + i).dot(Vec2fxN::load(bx + i, by + i)).store(out + i);
+  }
+
+  for (; i < count; i++) {
+    out[i] = ax[i] * bx[i] + ay[i] * by[i];
+  }
+}
+
+void rayc::lengthBatch(const float* x, const float* y, float* out, size_t count) {
+  size_t i = 0;
+  for (; i + WIDTH <= count; i += WIDTH) {
+    Vec2fxN::load(x + i, y + i).length().store(out + i);
+  }
+
+  for (; i < count; i++) {
+    out[i] = std::sqrt(x[i] * x[i] + y[i] * y[i]);
+  }
+}
+
+void rayc::normalizeBatch(float* x, float* y, size_t count) {
+  size_t i = 0;
+  for (; i + WIDTH <= count; i += WIDTH) {
+    Vec2fxN::load(x + i, y + i).normalized().store(x + i, y + i);
+  }
+
+  for (; i < count; i++) {
+    float length = std::sqrt(x[i] * x[i] + y[i] * y[i]);
+    if (length > 0) {
+      x[i] /= length;
+      y[i] /= length;
+    }
+  }
+}
+
+void rayc::integrateBatch(const Vec2d* positions, const Vec2d* velocities, Vec2d* out, size_t count, double time) {
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  // A Vec2d is exactly one register, x in the low lane
+  static_assert(sizeof(Vec2d) == 2 * sizeof(double), "Vec2d has to be two packed doubles");
+
+  __m128d scale = _mm_set1_pd(time);
+  for (; i < count; i++) {
+    __m128d position = _mm_loadu_pd(&positions[i].x);
+    __m128d velocity = _mm_loadu_pd(&velocities[i].x);
+    _mm_storeu_pd(&out[i].x, _mm_add_pd(position, _mm_mul_pd(velocity, scale)));
+  }
+#endif
+
+  for (; i < count; i++) {
+    out[i] = positions[i] + velocities[i] * time;
+  }
+}
@@ -0,0 +1,263 @@
+#include <rayc/app.h>
+#include <rayc/map.h>
+#include <rayc/log.h>
+#include <rayc/config.h>
+#include <rayc/raycast.h>
+#include <rayc/version.h>
+#include <rayc/strutils.h>
+#include <rayc/video/font.h>
+#include <rayc/video/color.h>
+
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <algorithm>
+#include <filesystem>
+
+using namespace rayc;
+
+// Keeps results alive so the optimizer can't drop the work being measured
+static volatile double g_sink = 0;
+
+struct BenchOptions {
+  int warmup = 3;
+  int repetitions = 15;
+  double minSampleTime = 0.002; // seconds, short functions are repeated until a sample takes this long
+  std::string filter;
+  FILE* results = stdout;
+};
+
+// Times fn in samples of many iterations after a warm-up, then writes one JSON line of per-iteration
+// statistics, so two runs can be compared line by line by name
+class Bench {
+ private:
+  BenchOptions m_options;
+
+ public:
+  Bench(const BenchOptions& options) : m_options(options) {}
+
+  template <typename F>
+  void run(const std::string& name, F fn) {
+    if (!m_options.filter.empty() && name.find(m_options.filter) == std::string::npos) {
+      return;
+    }
+
+    for (int i = 0; i < m_options.warmup; i++) {
+      measure(fn, 1);
+    }
+
+    long iterations = 1;
+    while (measure(fn, iterations) < m_options.minSampleTime) {
+      iterations *= 2;
+    }
+
+    std::vector<double> samples(m_options.repetitions);
+    for (auto& sample : samples) {
+      sample = measure(fn, iterations) / iterations * 1e9;
+    }
+    std::sort(samples.begin(), samples.end());
+
+    double mean = 0;
+    for (double sample : samples) {
+      mean += sample;
+    }
+    mean /= samples.size();
+
+    double variance = 0;
+    for (double sample : samples) {
+      variance += (sample - mean) * (sample - mean);
+    }
+    double stddev = samples.size() > 1 ? std::sqrt(variance / (samples.size() - 1)) : 0;
+
+    double median = samples[samples.size() / 2];
+    double p95 = samples[std::min(samples.size() - 1, (size_t)std::ceil(samples.size() * 0.95) - 1)];
+
+    fprintf(m_options.results,
+      "{\"name\": \"%s\", \"iterations\": %ld, \"samples\": %zu, \"min_ns\": %.1f, \"median_ns\": %.1f, "
+      "\"mean_ns\": %.1f, \"stddev_ns\": %.1f, \"p95_ns\": %.1f, \"max_ns\": %.1f}\n",
+      name.c_str(), iterations, samples.size(), samples.front(), median, mean, stddev, p95, samples.back());
+    fflush(m_options.results);
+
+    if (m_options.results != stdout) {
+      printf("%-32s %12.1f ns  +- %5.1f%%\n", name.c_str(), median, mean > 0 ? stddev / mean * 100 : 0);
+    }
+  }
+
+ private:
+  template <typename F>
+  static double measure(F& fn, long iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+      fn();
+    }
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    return duration.count();
+  }
+};
+
+// Walled border and scattered pillars of mixed heights, seeded so every run sees the same map
+static Map generateMap(int size, std::mt19937& rng) {
+  Map map(size, size);
+
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      MapTile& tile = map.getTile(x, y);
+      bool border = x == 0 || y == 0 || x == size - 1 || y == size - 1;
+      tile = {0, 0, 1};
+      if (border || rng() % 100 < 12) {
+        tile.texture = 1 + rng() % 4;
+        tile.height = 1 + rng() % 3;
+      }
+    }
+  }
+
+  map.getTile(size / 2, size / 2) = {0, 0, 1};
+  return map;
+}
+
+static std::string generateConfig(int sections, int keys) {
+  std::string src = "# generated by rayc_microbench\n";
+  for (int s = 0; s < sections; s++) {
+    src += "[section" + std::to_string(s) + "]\n";
+    for (int k = 0; k < keys; k++) {
+      src += "key" + std::to_string(k) + " = value " + std::to_string(s * keys + k) + "\n";
+    }
+    src += "\n";
+  }
+  return src;
+}
+
+static void benchMaps(Bench& bench, std::mt19937& rng) {
+  const int SIZES[] = {64, 256, 1024};
+  const int ANGLES[] = {0, 30, 45, 90};
+  const int FAN_RAYS = 320;
+  const double FOV = M_PI / 3;
+
+  std::string path = (std::filesystem::temp_directory_path() / "rayc_microbench.map").string();
+
+  for (int size : SIZES) {
+    Map map = generateMap(size, rng);
+    std::string suffix = "/" + std::to_string(size);
+
+    map.save(path);
+    bench.run("Map::load" + suffix, [&]() {
+      Map loaded = Map::load(path);
+      g_sink = g_sink + loaded.width;
+    });
+
+    // A screen's worth of columns from the middle of the map, axis aligned and diagonal views walk differently
+    Vec2d origin = {size / 2 + 0.5, size / 2 + 0.5};
+    for (int angle : ANGLES) {
+      double heading = angle * M_PI / 180;
+      std::vector<Ray> fan(FAN_RAYS);
+      for (int i = 0; i < FAN_RAYS; i++) {
+        double rayAngle = heading - FOV / 2 + FOV * i / FAN_RAYS;
+        fan[i].origin = origin;
+        fan[i].direction = {std::sin(rayAngle), std::cos(rayAngle)};
+        fan[i].maxDistance = size;
+      }
+
+      bench.run("castRay/fan" + suffix + "/" + std::to_string(angle), [&]() {
+        double total = 0;
+        for (auto& ray : fan) {
+          total += castRay(map, ray).distance;
+        }
+        g_sink = g_sink + total;
+      });
+    }
+  }
+
+  std::filesystem::remove(path);
+}
+
+static void benchStrings(Bench& bench, std::mt19937& rng) {
+  for (int sections : {10, 100, 1000}) {
+    std::string src = generateConfig(sections, 20);
+    bench.run("Config::fromString/" + std::to_string(sections * 20), [&]() {
+      Config config = Config::fromString(src);
+      g_sink = g_sink + config.getSection("section0").size();
+    });
+  }
+
+  std::string shortLine = "tile 12 34 5 2";
+  bench.run("splitstr/short", [&]() {
+    g_sink = g_sink + splitstr(shortLine).size();
+  });
+
+  std::string longLine;
+  for (int i = 0; i < 10000; i++) {
+    longLine += std::to_string(rng() % 1000) + " ";
+  }
+  bench.run("splitstr/10000", [&]() {
+    g_sink = g_sink + splitstr(longLine).size();
+  });
+}
+
+// Needs a window for the renderer, so only runs when given a font
+static void benchFont(Bench& bench, const std::string& fontFile) {
+  rayc::init(640, 480);
+
+  Font font(fontFile, 14);
+  std::string fps = "  60";
+  std::string line = "The quick brown fox jumps over the lazy dog 0123456789";
+
+  bench.run("Font::draw/4", [&]() {
+    font.draw(fps, {0, 0}, RGB_WHITE);
+  });
+  bench.run("Font::draw/54", [&]() {
+    font.draw(line, {0, 16}, RGB_WHITE);
+  });
+
+  rayc::shutdown();
+}
+
+int main(int argc, char ** argv) {
+  BenchOptions options;
+  std::string fontFile;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      error("Usage: %s [-o RESULTS_FILE] [-r REPETITIONS] [-w WARMUP] [-f FILTER] [--font FONT_FILE]", argv[0]);
+      return 1;
+    }
+    if (arg == "-o") {
+      options.results = fopen(argv[++i], "w");
+      if (!options.results) {
+        error("Can't open file '%s'", argv[i]);
+        return 1;
+      }
+    } else if (arg == "-r") {
+      options.repetitions = std::max(std::stoi(argv[++i]), 1);
+    } else if (arg == "-w") {
+      options.warmup = std::max(std::stoi(argv[++i]), 0);
+    } else if (arg == "-f") {
+      options.filter = argv[++i];
+    } else if (arg == "--font") {
+      fontFile = argv[++i];
+    } else {
+      error("Unknown option '%s'", arg.c_str());
+      return 1;
+    }
+  }
+
+  setLogLevel(LogLevel::WARNING);
+  fprintf(options.results, "{\"version\": \"%s\", \"repetitions\": %d, \"warmup\": %d}\n", RAYC_VERSION_STRING, options.repetitions, options.warmup);
+
+  std::mt19937 rng(1234);
+  Bench bench(options);
+
+  benchMaps(bench, rng);
+  benchStrings(bench, rng);
+  if (!fontFile.empty()) {
+    benchFont(bench, fontFile);
+  }
+
+  if (options.results != stdout) {
+    fclose(options.results);
+  }
+  return 0;
+}
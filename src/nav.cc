@@ -0,0 +1,379 @@
+#include <rayc/nav.h>
+
+#include <cmath>
+#include <algorithm>
+
+// Opposite directions differ only in the lowest bit
+static const int NEIGHBOUR_X[8] = {1, -1, 0,  0, 1, -1,  1, -1};
+static const int NEIGHBOUR_Y[8] = {0,  0, 1, -1, 1, -1, -1,  1};
+static const uint32_t NEIGHBOUR_COST[8] = {10, 10, 10, 10, 14, 14, 14, 14};
+
+static inline uint64_t queueEntry(uint32_t cost, int index) {
+  return ((uint64_t)cost << 32) | (uint32_t)index;
+}
+
+bool rayc::FlowField::isWalkable(const MapTile& tile) {
+  return tile.isPassable();
+}
+
+void rayc::FlowField::reset(const Map& map) {
+  m_width = map.width;
+  m_height = map.height;
+  m_goal = {-1, -1};
+
+  m_walkable.resize(m_width * m_height);
+  for (int i = 0; i < m_width * m_height; i++) {
+    m_walkable[i] = isWalkable(map.getTile(i));
+  }
+
+  m_cost.assign(m_width * m_height, UNREACHABLE);
+  m_flow.assign(m_width * m_height, NO_FLOW);
+  m_invalid.assign(m_width * m_height, 0);
+}
+
+void rayc::FlowField::rebuild() {
+  std::fill(m_cost.begin(), m_cost.end(), UNREACHABLE);
+  std::fill(m_flow.begin(), m_flow.end(), NO_FLOW);
+
+  if (!isWalkable(m_goal)) {
+    return;
+  }
+
+  // Single source and step costs of at most 14, so a ring of cost buckets replaces the heap
+  const int RING = 16;
+  std::vector<int> buckets[RING];
+
+  int goal = m_goal.y * m_width + m_goal.x;
+  m_cost[goal] = 0;
+  buckets[0].push_back(goal);
+
+  size_t queued = 1;
+  for (uint32_t cost = 0; queued; cost++) {
+    std::vector<int>& bucket = buckets[cost % RING];
+
+    for (size_t i = 0; i < bucket.size(); i++) {
+      int index = bucket[i];
+      queued--;
+
+      if (m_cost[index] != cost) {
+        continue;
+      }
+
+      int x = index % m_width, y = index / m_width;
+      for (int d = 0; d < 8; d++) {
+        if (!canMove(x, y, d)) {
+          continue;
+        }
+
+        int neighbour = index + NEIGHBOUR_Y[d] * m_width + NEIGHBOUR_X[d];
+        uint32_t neighbourCost = cost + NEIGHBOUR_COST[d];
+
+        if (neighbourCost < m_cost[neighbour]) {
+          m_cost[neighbour] = neighbourCost;
+          m_flow[neighbour] = d ^ 1;
+          buckets[neighbourCost % RING].push_back(neighbour);
+          queued++;
+        }
+      }
+    }
+
+    bucket.clear();
+  }
+}
+
+void rayc::FlowField::setGoal(Vec2i goal) {
+  if (goal == m_goal) {
+    return;
+  }
+
+  // Moving the goal shifts the cost of every tile behind it, so a repair would touch the whole
+  // field anyway and the bucket rebuild is the cheaper way to get there
+  m_goal = goal;
+  rebuild();
+}
+
+void rayc::FlowField::setWalkable(Vec2i tile, bool walkable) {
+  if (tile.x < 0 || tile.y < 0 || tile.x >= m_width || tile.y >= m_height) {
+    return;
+  }
+
+  int index = tile.y * m_width + tile.x;
+  if (m_walkable[index] == walkable) {
+    return;
+  }
+
+  m_walkable[index] = walkable;
+  m_queue.clear();
+
+  if (walkable) {
+    // The tile and every diagonal that was blocked by its corner open up
+    if (tile == m_goal) {
+      m_cost[index] = 0;
+      m_flow[index] = NO_FLOW;
+    }
+    for (int d = 0; d < 8; d++) {
+      int neighbour = index + NEIGHBOUR_Y[d] * m_width + NEIGHBOUR_X[d];
+      if (canMove(tile.x, tile.y, d) && m_cost[neighbour] != UNREACHABLE && m_cost[neighbour] + NEIGHBOUR_COST[d] < m_cost[index]) {
+        m_cost[index] = m_cost[neighbour] + NEIGHBOUR_COST[d];
+        m_flow[index] = d;
+      }
+    }
+    for (int d = 0; d < 8; d++) {
+      int x = tile.x + NEIGHBOUR_X[d], y = tile.y + NEIGHBOUR_Y[d];
+      if (x >= 0 && y >= 0 && x < m_width && y < m_height && m_cost[y * m_width + x] != UNREACHABLE) {
+        push(y * m_width + x, m_cost[y * m_width + x]);
+      }
+    }
+    if (m_cost[index] != UNREACHABLE) {
+      push(index, m_cost[index]);
+    }
+    propagate();
+    return;
+  }
+
+  // Blocked: the tile's subtree loses its route, and so does any diagonal that cut past its corner
+  invalidateFrom(index);
+  for (int d = 0; d < 8; d++) {
+    int x = tile.x + NEIGHBOUR_X[d], y = tile.y + NEIGHBOUR_Y[d];
+    if (x < 0 || y < 0 || x >= m_width || y >= m_height) {
+      continue;
+    }
+
+    int neighbour = y * m_width + x;
+    uint8_t flow = m_flow[neighbour];
+    if (m_invalid[neighbour] || flow == NO_FLOW || flow < 4) {
+      continue;
+    }
+
+    bool cutsCorner = (x + NEIGHBOUR_X[flow] == tile.x && y == tile.y) || (x == tile.x && y + NEIGHBOUR_Y[flow] == tile.y);
+    if (cutsCorner) {
+      invalidateFrom(neighbour);
+    }
+  }
+  repairInvalidated();
+}
+
+rayc::Vec2i rayc::FlowField::getGoal() const {
+  return m_goal;
+}
+
+uint32_t rayc::FlowField::getCost(Vec2i tile) const {
+  if (tile.x < 0 || tile.y < 0 || tile.x >= m_width || tile.y >= m_height) {
+    return UNREACHABLE;
+  }
+  return m_cost[tile.y * m_width + tile.x];
+}
+
+bool rayc::FlowField::isWalkable(Vec2i tile) const {
+  if (tile.x < 0 || tile.y < 0 || tile.x >= m_width || tile.y >= m_height) {
+    return false;
+  }
+  return m_walkable[tile.y * m_width + tile.x];
+}
+
+rayc::Vec2d rayc::FlowField::getDirection(Vec2d position) const {
+  Vec2i tile = {(int)std::floor(position.x), (int)std::floor(position.y)};
+  if (tile.x < 0 || tile.y < 0 || tile.x >= m_width || tile.y >= m_height) {
+    return {0, 0};
+  }
+
+  uint8_t flow = m_flow[tile.y * m_width + tile.x];
+  if (flow == NO_FLOW) {
+    return {0, 0};
+  }
+
+  Vec2d target = {tile.x + NEIGHBOUR_X[flow] + 0.5, tile.y + NEIGHBOUR_Y[flow] + 0.5};
+  Vec2d direction = target - position;
+  double length = std::sqrt(direction.dot(direction));
+  return length > 0 ? direction / length : Vec2d(0, 0);
+}
+
+bool rayc::FlowField::canMove(int x, int y, int direction) const {
+  int toX = x + NEIGHBOUR_X[direction];
+  int toY = y + NEIGHBOUR_Y[direction];
+
+  if (toX < 0 || toY < 0 || toX >= m_width || toY >= m_height || !m_walkable[toY * m_width + toX]) {
+    return false;
+  }
+
+  if (direction >= 4) {
+    return m_walkable[y * m_width + toX] && m_walkable[toY * m_width + x];
+  }
+
+  return true;
+}
+
+void rayc::FlowField::push(int index, uint32_t cost) {
+  m_queue.push_back(queueEntry(cost, index));
+  std::push_heap(m_queue.begin(), m_queue.end(), std::greater<uint64_t>());
+}
+
+// Dijkstra over whatever is queued, only ever lowers costs
+void rayc::FlowField::propagate() {
+  while (!m_queue.empty()) {
+    std::pop_heap(m_queue.begin(), m_queue.end(), std::greater<uint64_t>());
+    uint64_t entry = m_queue.back();
+    m_queue.pop_back();
+
+    uint32_t cost = entry >> 32;
+    int index = entry & 0xffffffff;
+
+    if (cost > m_cost[index] || !m_walkable[index]) {
+      continue;
+    }
+
+    int x = index % m_width, y = index / m_width;
+    for (int d = 0; d < 8; d++) {
+      if (!canMove(x, y, d)) {
+        continue;
+      }
+
+      int neighbour = index + NEIGHBOUR_Y[d] * m_width + NEIGHBOUR_X[d];
+      uint32_t neighbourCost = cost + NEIGHBOUR_COST[d];
+
+      if (neighbourCost < m_cost[neighbour]) {
+        m_cost[neighbour] = neighbourCost;
+        // Moves are symmetric, the neighbour flows back along the opposite direction
+        m_flow[neighbour] = d ^ 1;
+        push(neighbour, neighbourCost);
+      }
+    }
+  }
+}
+
+// Marks index and every tile whose flow leads through it
+void rayc::FlowField::invalidateFrom(int index) {
+  if (m_invalid[index]) {
+    return;
+  }
+
+  size_t first = m_invalidated.size();
+  m_invalid[index] = 1;
+  m_invalidated.push_back(index);
+
+  for (size_t i = first; i < m_invalidated.size(); i++) {
+    int current = m_invalidated[i];
+    int x = current % m_width, y = current / m_width;
+
+    for (int d = 0; d < 8; d++) {
+      int nx = x + NEIGHBOUR_X[d], ny = y + NEIGHBOUR_Y[d];
+      if (nx < 0 || ny < 0 || nx >= m_width || ny >= m_height) {
+        continue;
+      }
+
+      int neighbour = ny * m_width + nx;
+      uint8_t flow = m_flow[neighbour];
+      if (!m_invalid[neighbour] && flow != NO_FLOW && nx + NEIGHBOUR_X[flow] == x && ny + NEIGHBOUR_Y[flow] == y) {
+        m_invalid[neighbour] = 1;
+        m_invalidated.push_back(neighbour);
+      }
+    }
+  }
+}
+
+// Invalidated tiles take the best route offered by a valid neighbour, then Dijkstra spreads it
+void rayc::FlowField::repairInvalidated() {
+  for (int index : m_invalidated) {
+    m_cost[index] = UNREACHABLE;
+    m_flow[index] = NO_FLOW;
+  }
+
+  for (int index : m_invalidated) {
+    if (!m_walkable[index]) {
+      continue;
+    }
+
+    int x = index % m_width, y = index / m_width;
+    for (int d = 0; d < 8; d++) {
+      if (!canMove(x, y, d)) {
+        continue;
+      }
+
+      int neighbour = index + NEIGHBOUR_Y[d] * m_width + NEIGHBOUR_X[d];
+      if (m_invalid[neighbour] || m_cost[neighbour] == UNREACHABLE) {
+        continue;
+      }
+
+      if (m_cost[neighbour] + NEIGHBOUR_COST[d] < m_cost[index]) {
+        m_cost[index] = m_cost[neighbour] + NEIGHBOUR_COST[d];
+        m_flow[index] = d;
+      }
+    }
+
+    if (m_cost[index] != UNREACHABLE) {
+      push(index, m_cost[index]);
+    }
+  }
+
+  for (int index : m_invalidated) {
+    m_invalid[index] = 0;
+  }
+  m_invalidated.clear();
+
+  propagate();
+}
+
+rayc::NavService::~NavService() {
+  wait();
+}
+
+void rayc::NavService::reset(const Map& map, Vec2i goal) {
+  wait();
+
+  m_pending.clear();
+  m_fields[0].reset(map);
+  m_fields[0].setGoal(goal);
+  m_fields[1] = m_fields[0];
+  m_requestedGoal = goal;
+  m_front = 0;
+}
+
+void rayc::NavService::setGoal(Vec2i goal) {
+  if (goal != m_requestedGoal) {
+    m_requestedGoal = goal;
+    m_pending.push_back({true, goal, true});
+  }
+}
+
+void rayc::NavService::setWalkable(Vec2i tile, bool walkable) {
+  m_pending.push_back({false, tile, walkable});
+}
+
+void rayc::NavService::update() {
+  if (m_job && m_job->finished) {
+    m_front = 1 - m_front;
+    m_job = nullptr;
+  }
+
+  if (m_job || m_pending.empty()) {
+    return;
+  }
+
+  FlowField& back = m_fields[1 - m_front];
+  back = m_fields[m_front];
+
+  m_running.clear();
+  m_running.swap(m_pending);
+
+  m_job = jobs::submit([this, &back]() {
+    for (auto& change : m_running) {
+      if (change.isGoal) {
+        back.setGoal(change.tile);
+      } else {
+        back.setWalkable(change.tile, change.walkable);
+      }
+    }
+  });
+}
+
+void rayc::NavService::wait() {
+  if (m_job) {
+    jobs::wait(m_job);
+    m_front = 1 - m_front;
+    m_job = nullptr;
+  }
+}
+
+const rayc::FlowField& rayc::NavService::getField() const {
+  return m_fields[m_front];
+}
@@ -0,0 +1,148 @@
+#include <rayc/map.h>
+#include <rayc/nav.h>
+#include <rayc/jobs.h>
+#include <rayc/log.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <cstdio>
+
+using namespace rayc;
+
+// Recursive backtracker over odd cells, walls on the even grid lines
+static Map generateMaze(int cells, std::mt19937& rng) {
+  int size = cells * 2 + 1;
+  Map map(size, size);
+
+  for (auto& tile : map.tiles) {
+    tile = {0, 1, 1};
+  }
+
+  std::vector<Vec2i> stack = {{0, 0}};
+  std::vector<bool> visited(cells * cells, false);
+  visited[0] = true;
+  map.getTile(1, 1).texture = 0;
+
+  const int dx[4] = {1, -1, 0, 0};
+  const int dy[4] = {0, 0, 1, -1};
+
+  while (!stack.empty()) {
+    Vec2i cell = stack.back();
+
+    int options[4], count = 0;
+    for (int d = 0; d < 4; d++) {
+      int x = cell.x + dx[d], y = cell.y + dy[d];
+      if (x >= 0 && y >= 0 && x < cells && y < cells && !visited[y * cells + x]) {
+        options[count++] = d;
+      }
+    }
+
+    if (!count) {
+      stack.pop_back();
+      continue;
+    }
+
+    int d = options[rng() % count];
+    Vec2i next = {cell.x + dx[d], cell.y + dy[d]};
+    visited[next.y * cells + next.x] = true;
+    map.getTile(cell.x * 2 + 1 + dx[d], cell.y * 2 + 1 + dy[d]).texture = 0;
+    map.getTile(next.x * 2 + 1, next.y * 2 + 1).texture = 0;
+    stack.push_back(next);
+  }
+
+  // Knock out some walls so there is more than one route, those become doors
+  for (int i = 0; i < cells * cells / 8; i++) {
+    int x = 1 + rng() % (size - 2), y = 1 + rng() % (size - 2);
+    if ((x + y) % 2 == 1) {
+      map.getTile(x, y).texture = 0;
+    }
+  }
+
+  return map;
+}
+
+template <typename F>
+static double measure(int repetitions, F fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repetitions; i++) {
+    fn(i);
+  }
+  std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+  return duration.count() / repetitions;
+}
+
+int main(int argc, char ** argv) {
+  int cells = argc > 1 ? std::stoi(argv[1]) : 512;
+  int npcs = argc > 2 ? std::stoi(argv[2]) : 10000;
+
+  std::mt19937 rng(1234);
+  Map map = generateMaze(cells, rng);
+  int size = map.width;
+
+  std::vector<Vec2i> openTiles;
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      if (!map.getTile(x, y).isSolid()) {
+        openTiles.push_back({x, y});
+      }
+    }
+  }
+
+  printf("maze %dx%d, %zu open tiles, %d npcs\n", size, size, openTiles.size(), npcs);
+
+  FlowField field;
+  field.reset(map);
+  field.setGoal(openTiles[0]);
+
+  printf("full build:        %10.3f ms\n", measure(5, [&](int) { field.rebuild(); }));
+
+  // A player walking: the goal moves to a neighbouring open tile every tick
+  Vec2i goal = openTiles[openTiles.size() / 2];
+  field.setGoal(goal);
+  printf("goal step:         %10.3f ms\n", measure(100, [&](int) {
+    const int dx[4] = {1, -1, 0, 0};
+    const int dy[4] = {0, 0, 1, -1};
+    for (int d = 0, start = rng() % 4; d < 4; d++) {
+      Vec2i next = {goal.x + dx[(start + d) % 4], goal.y + dy[(start + d) % 4]};
+      if (field.isWalkable(next)) {
+        goal = next;
+        break;
+      }
+    }
+    field.setGoal(goal);
+  }));
+
+  printf("door toggle:       %10.3f ms\n", measure(100, [&](int) {
+    Vec2i tile = openTiles[rng() % openTiles.size()];
+    field.setWalkable(tile, false);
+    field.setWalkable(tile, true);
+  }));
+
+  std::vector<Vec2d> positions(npcs);
+  for (auto& position : positions) {
+    Vec2i tile = openTiles[rng() % openTiles.size()];
+    position = {tile.x + 0.5, tile.y + 0.5};
+  }
+
+  printf("npc lookups:       %10.3f ms\n", measure(100, [&](int) {
+    for (auto& position : positions) {
+      position += field.getDirection(position) * 0.01;
+    }
+  }));
+
+  jobs::init();
+  NavService service;
+  service.reset(map, goal);
+
+  printf("service goal step: %10.3f ms\n", measure(100, [&](int i) {
+    service.setGoal(openTiles[(openTiles.size() / 2 + i) % openTiles.size()]);
+    service.update();
+    service.wait();
+  }));
+
+  jobs::shutdown();
+
+  return 0;
+}
@@ -1,17 +1,306 @@
 #include <rayc/object.h>
+#include <rayc/math/batch.h>
 
-rayc::GameObject::GameObject(Vec2d position, Texture* texture)
-  : position(position), texture(texture) {}
+#include <cmath>
 
-rayc::GameObject::GameObject(GameObjectType type, Vec2d position, Vec2d velocity, Texture* texture)
-  : type(type), position(position), velocity(velocity), texture(texture) {}
+void rayc::ObjectStore::setBounds(int width, int height, int cellSize) {
+  m_spatial.reset(width, height, cellSize);
 
-void rayc::GameObject::onCollision(GameObject* collided) {
-  remove = true;
+  for (int type = 0; type < OBJTYPE_COUNT; type++) {
+    ObjectPool& pool = m_pools[type];
+    for (size_t i = 0; i < pool.size(); i++) {
+      m_spatial.insert(getHandle((GameObjectType)type, i), pool.position[i], pool.radius[i]);
+    }
+  }
+}
+
+rayc::ObjectHandle rayc::ObjectStore::create(GameObjectType type, Vec2d position, Vec2d velocity, int sprite, float radius, uint8_t flags) {
+  uint32_t slotIndex;
+  if (!m_freeSlots.empty()) {
+    slotIndex = m_freeSlots.back();
+    m_freeSlots.pop_back();
+  } else {
+    slotIndex = m_slots.size();
+    m_slots.push_back({});
+  }
+
+  ObjectPool& pool = m_pools[type];
+
+  Slot& slot = m_slots[slotIndex];
+  slot.type = type;
+  slot.index = pool.size();
+  slot.alive = true;
+
+  pool.position.push_back(position);
+  pool.velocity.push_back(velocity);
+  pool.sprite.push_back(sprite);
+  pool.flags.push_back(flags);
+  pool.radius.push_back(radius);
+  pool.slot.push_back(slotIndex);
+
+  m_count++;
+
+  ObjectHandle handle = {slotIndex, slot.generation};
+  m_spatial.insert(handle, position, radius);
+  return handle;
+}
+
+void rayc::ObjectStore::destroy(ObjectHandle handle) {
+  if (!isAlive(handle)) {
+    return;
+  }
+
+  Slot& slot = m_slots[handle.index];
+  removeAt((GameObjectType)slot.type, slot.index);
+}
+
+bool rayc::ObjectStore::isAlive(ObjectHandle handle) const {
+  return handle.index < m_slots.size()
+    && m_slots[handle.index].alive
+    && m_slots[handle.index].generation == handle.generation;
+}
+
+void rayc::ObjectStore::markForRemoval(ObjectHandle handle) {
+  if (isAlive(handle)) {
+    getFlags(handle) |= OBJFLAG_REMOVE;
+  }
 }
 
-void rayc::GameObject::onFrameUpdate(float frameTile) {
-  if (type == OBJTYPE_PROJECTILE) {
-    position += velocity * frameTile;
+void rayc::ObjectStore::removeMarked() {
+  for (int type = 0; type < OBJTYPE_COUNT; type++) {
+    ObjectPool& pool = m_pools[type];
+    // Backwards, so the element swapped into i has already been checked
+    for (size_t i = pool.size(); i-- > 0;) {
+      if (pool.flags[i] & OBJFLAG_REMOVE) {
+        removeAt((GameObjectType)type, i);
+      }
+    }
+  }
+}
+
+rayc::ObjectHandle rayc::ObjectStore::getHandle(GameObjectType type, size_t index) const {
+  uint32_t slotIndex = m_pools[type].slot[index];
+  return {slotIndex, m_slots[slotIndex].generation};
+}
+
+rayc::GameObjectType rayc::ObjectStore::getType(ObjectHandle handle) const {
+  return (GameObjectType)m_slots[handle.index].type;
+}
+
+rayc::Vec2d& rayc::ObjectStore::getPosition(ObjectHandle handle) {
+  const Slot& slot = m_slots[handle.index];
+  return m_pools[slot.type].position[slot.index];
+}
+
+rayc::Vec2d& rayc::ObjectStore::getVelocity(ObjectHandle handle) {
+  const Slot& slot = m_slots[handle.index];
+  return m_pools[slot.type].velocity[slot.index];
+}
+
+uint8_t& rayc::ObjectStore::getFlags(ObjectHandle handle) {
+  const Slot& slot = m_slots[handle.index];
+  return m_pools[slot.type].flags[slot.index];
+}
+
+uint16_t rayc::ObjectStore::getSprite(ObjectHandle handle) const {
+  const Slot& slot = m_slots[handle.index];
+  return m_pools[slot.type].sprite[slot.index];
+}
+
+float rayc::ObjectStore::getRadius(ObjectHandle handle) const {
+  const Slot& slot = m_slots[handle.index];
+  return m_pools[slot.type].radius[slot.index];
+}
+
+void rayc::ObjectStore::syncPosition(ObjectHandle handle) {
+  if (isAlive(handle)) {
+    m_spatial.move(handle, getPosition(handle));
+  }
+}
+
+const rayc::SpatialHash& rayc::ObjectStore::getSpatialHash() const {
+  return m_spatial;
+}
+
+const std::vector<rayc::ProjectileImpact>& rayc::ObjectStore::getImpacts() const {
+  return m_sweep.impacts;
+}
+
+rayc::ObjectPool& rayc::ObjectStore::getPool(GameObjectType type) {
+  return m_pools[type];
+}
+
+const rayc::ObjectPool& rayc::ObjectStore::getPool(GameObjectType type) const {
+  return m_pools[type];
+}
+
+size_t rayc::ObjectStore::size() const {
+  return m_count;
+}
+
+void rayc::ObjectStore::clear() {
+  for (auto& pool : m_pools) {
+    pool = ObjectPool();
+  }
+
+  // Bump generations so handles from before the clear stay stale
+  m_freeSlots.clear();
+  for (uint32_t i = m_slots.size(); i-- > 0;) {
+    if (m_slots[i].alive) {
+      m_slots[i].generation++;
+      m_slots[i].alive = false;
+    }
+    m_freeSlots.push_back(i);
+  }
+
+  m_count = 0;
+  m_spatial.clear();
+}
+
+void rayc::ObjectStore::update(Map& map, float frameTime, const FlowField* flow, Vec2i viewer) {
+  updateProjectiles(m_pools[OBJTYPE_PROJECTILE], map, frameTime, m_sweep);
+
+  if (flow) {
+    updateNpcs(m_pools[OBJTYPE_NPC], *flow, frameTime, &map.visibility, map.visibility.getCluster(viewer));
+  }
+
+  for (auto& impact : m_sweep.impacts) {
+    impact.handle = getHandle(OBJTYPE_PROJECTILE, impact.handle.index);
+  }
+
+  // Stationary objects never move, only the other pools are rehashed
+  syncPool(OBJTYPE_PROJECTILE);
+  syncPool(OBJTYPE_NPC);
+
+  collideProjectiles();
+  removeMarked();
+}
+
+void rayc::ObjectStore::removeAt(GameObjectType type, size_t index) {
+  ObjectPool& pool = m_pools[type];
+  size_t last = pool.size() - 1;
+
+  uint32_t removedSlot = pool.slot[index];
+  m_spatial.remove({removedSlot, m_slots[removedSlot].generation});
+  m_slots[removedSlot].alive = false;
+  m_slots[removedSlot].generation++;
+  m_freeSlots.push_back(removedSlot);
+
+  if (index != last) {
+    pool.position[index] = pool.position[last];
+    pool.velocity[index] = pool.velocity[last];
+    pool.sprite[index] = pool.sprite[last];
+    pool.flags[index] = pool.flags[last];
+    pool.radius[index] = pool.radius[last];
+    pool.slot[index] = pool.slot[last];
+    m_slots[pool.slot[index]].index = index;
+  }
+
+  pool.position.pop_back();
+  pool.velocity.pop_back();
+  pool.sprite.pop_back();
+  pool.flags.pop_back();
+  pool.radius.pop_back();
+  pool.slot.pop_back();
+
+  m_count--;
+}
+
+void rayc::ObjectStore::syncPool(GameObjectType type) {
+  ObjectPool& pool = m_pools[type];
+  for (size_t i = 0; i < pool.size(); i++) {
+    m_spatial.move({pool.slot[i], m_slots[pool.slot[i]].generation}, pool.position[i]);
+  }
+}
+
+// A projectile stops at the first NPC it touches, queried from the NPC side since there are fewer of them
+void rayc::ObjectStore::collideProjectiles() {
+  ObjectPool& npcs = m_pools[OBJTYPE_NPC];
+
+  for (size_t i = 0; i < npcs.size(); i++) {
+    m_queryResult.clear();
+    m_spatial.queryRadius(npcs.position[i], npcs.radius[i], m_queryResult);
+
+    for (auto& other : m_queryResult) {
+      if (getType(other) == OBJTYPE_PROJECTILE) {
+        getFlags(other) |= OBJFLAG_REMOVE;
+      }
+    }
+  }
+}
+
+static bool isBlocking(rayc::Map& map, rayc::Vec2i tile) {
+  return tile.x < 0 || tile.y < 0 || tile.x >= map.width || tile.y >= map.height || map.getTile(tile).isSolid();
+}
+
+void rayc::updateProjectiles(ObjectPool& pool, Map& map, float frameTime, ProjectileSweep& sweep) {
+  size_t count = pool.size();
+
+  sweep.target.resize(count);
+  sweep.crossing.clear();
+  sweep.impacts.clear();
+
+  // Straight-line pass over contiguous arrays
+  integrateBatch(pool.position.data(), pool.velocity.data(), sweep.target.data(), count, frameTime);
+
+  // Most projectiles don't leave their tile in one tick, those only need the tile under the target
+  for (size_t i = 0; i < count; i++) {
+    Vec2d& from = pool.position[i];
+    Vec2d& to = sweep.target[i];
+
+    if (std::floor(from.x) == std::floor(to.x) && std::floor(from.y) == std::floor(to.y)) {
+      pool.position[i] = to;
+      if (isBlocking(map, {(int)std::floor(to.x), (int)std::floor(to.y)})) {
+        pool.flags[i] |= OBJFLAG_REMOVE;
+      }
+    } else {
+      sweep.crossing.push_back(i);
+    }
+  }
+
+  // The rest walk their segment with the same DDA as the renderer and stop on the first solid tile
+  for (uint32_t i : sweep.crossing) {
+    Vec2d from = pool.position[i];
+    Vec2d segment = sweep.target[i] - from;
+    double length = std::sqrt(segment.dot(segment));
+
+    GridDDA dda(from, segment);
+    bool blocked = false;
+
+    while (true) {
+      dda.advance();
+      if (dda.distance > length) {
+        break;
+      }
+
+      if (isBlocking(map, dda.tile)) {
+        blocked = true;
+        break;
+      }
+    }
+
+    if (blocked) {
+      Vec2d point = from + segment * (dda.distance / length);
+      pool.position[i] = point;
+      pool.flags[i] |= OBJFLAG_REMOVE;
+      sweep.impacts.push_back({{i, 0}, point, dda.tile, dda.entrySide});
+    } else {
+      pool.position[i] = sweep.target[i];
+    }
+  }
+}
+
+void rayc::updateNpcs(ObjectPool& pool, const FlowField& flow, float frameTime, const MapVisibility* visibility, int viewerCluster) {
+  for (size_t i = 0; i < pool.size(); i++) {
+    if (visibility && viewerCluster >= 0) {
+      Vec2i tile = {(int)std::floor(pool.position[i].x), (int)std::floor(pool.position[i].y)};
+      if (!visibility->canSeeCluster(viewerCluster, visibility->getCluster(tile))) {
+        pool.velocity[i] = {0, 0};
+        continue;
+      }
+    }
+
+    pool.velocity[i] = flow.getDirection(pool.position[i]) * NPC_SPEED;
+    pool.position[i] += pool.velocity[i] * frameTime;
   }
 }
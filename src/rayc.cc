@@ -1,22 +1,31 @@
 #include <rayc/app.h>
 #include <rayc/log.h>
+#include <rayc/jobs.h>
 #include <rayc/data.h>
 #include <rayc/config.h>
 #include <rayc/map.h>
 #include <rayc/object.h>
+#include <rayc/nav.h>
+#include <rayc/door.h>
+#include <rayc/light.h>
+#include <rayc/raycast.h>
 #include <rayc/player.h>
 #include <rayc/intutils.h>
 #include <rayc/strutils.h>
+#include <rayc/math/batch.h>
 #include <rayc/video/draw.h>
 #include <rayc/video/color.h>
 #include <rayc/video/font.h>
+#include <rayc/video/shade.h>
+#include <rayc/video/sprite.h>
 #include <rayc/video/texture.h>
 
 #include <memory>
 #include <chrono>
 #include <string>
 #include <vector>
-#include <list>
+#include <algorithm>
+#include <limits>
 #include <map>
 
 using namespace rayc;
@@ -28,6 +37,7 @@ struct Raycaster {
     std::vector<Texture> sprites;
     rayc::Texture texturePlaceholder;
     rayc::Texture textureOverlay;
+    rayc::Texture sky;
     Map map;
   } res;
 
@@ -60,27 +70,85 @@ struct Raycaster {
 
   float* depthBuffer = nullptr;
 
-  std::list<std::pair<int, std::unique_ptr<GameObject>>> objects;
+  int columnGrainSize = 32;
+
+  // Interlaced columns: half the columns are cast each frame, the other half reuse the previous
+  // frame's hit on the same face when both fresh neighbours agree on it
+  bool interlacedColumns = false;
+  int columnParity = 0;
+  int columnHistoryWidth = 0;
+
+  ObjectStore objects;
+  NavService nav;
+  LightGrid lights;
+  DoorSystem doors;
+  std::vector<ObjectHandle> doorOccupants;
+  ShadeTable shades;
+
+  std::vector<SpriteInstance> visibleSprites;
+  std::vector<SpriteInstance> spriteScratch;
+  std::vector<uint32_t> spriteCandidates;
+  std::vector<Vec2d> spritePositions;
+  std::vector<float> spriteDepths;
+  std::vector<float> spriteLaterals;
+  DepthSummary depthSummary;
+
+  // Up to MAX_WALL_LAYERS visible walls per column, nearest first
+  static const int MAX_WALL_LAYERS = COLUMN_MAX_LAYERS;
+  std::vector<RayHit> columnHits;
+  std::vector<uint8_t> columnLayers;
+  std::vector<SeeThroughHits> columnSeeThrough;
+  std::vector<float> seeThroughDepth; // per column, nearest see-through tile
+  int maxWallHeight = 1;
+
+  // Software floor and ceiling, only used when the map has textured surfaces
+  bool texturedSurfaces = false;
+  Texture surfaceBuffer;
+  std::vector<uint32_t> surfacePixels;
+  std::vector<Vec2d> columnDirections;
+  std::vector<float> columnStretch;
+  std::vector<float> columnNearest;
+
+  // Dynamic resolution: the world is drawn to the top left viewWidth x viewHeight of viewBuffer and
+  // stretched over the window, the scale follows the render time measured over a few frames
+  static const int RESOLUTION_WINDOW = 8;
+  bool dynamicResolution = false;
+  float resolutionScale = 1.0f;
+  float minResolutionScale = 0.5f;
+  float resolutionRenderTime = 0.0f;
+  int resolutionFrames = 0;
+  int viewWidth = 0;
+  int viewHeight = 0;
+  Texture viewBuffer;
+
+  // Frame cache: the world image stays in viewBuffer between frames, a frame with the same signature
+  // only redraws the columns under sprites that changed
+  struct FrameSignature {
+    Vec2d position;
+    float angle = 0.0f;
+    float fov = 0.0f;
+    float rayDistance = 0.0f;
+    int width = 0;
+    int height = 0;
 
-  enum Side {
-    NORTH, SOUTH, WEST, EAST, TOP, BOTTOM
+    bool operator==(const FrameSignature& rhs) const {
+      return position == rhs.position && angle == rhs.angle && fov == rhs.fov && rayDistance == rhs.rayDistance
+        && width == rhs.width && height == rhs.height;
+    }
   };
 
-  struct TileHit {
-    Vec2i tilePosition {0, 0};
-    Vec2d hitPosition {0, 0};
-    float rayLength = 0.0f;
-    float sampleX = 0.0f;
-    Side side = NORTH;
-  };
+  bool frameCache = false;
+  bool worldDirty = true; // anything the signature doesn't see, e.g. console commands
+  FrameSignature lastSignature;
+  std::vector<SpriteInstance> cachedSprites;
+  std::vector<uint32_t> cachedSlots; // per object slot, index + 1 into cachedSprites or 0
+  std::vector<uint8_t> cachedMatched;
+  int redrawnColumns = 0;
 
-  struct DDAResult {
-    bool hitWall = false;
-    bool hitDoor = false;
-    
-    TileHit tile;
-    TileHit door; // std::vector<TileHit> doors;
-  };
+  // Texture column offset of every screen column relative to the view angle, depends only on fov and sizes
+  std::vector<float> skyColumns;
+  float skyFov = 0.0f;
+  int skyWidth = 0;
 
  public:
   void init();
@@ -92,8 +160,24 @@ struct Raycaster {
   void unloadMap();
 
  private:
-  DDAResult castRay(Vec2d src, Vec2d direction);
   void render(float frameTime);
+  void updateResolution(float renderTime);
+  Ray getColumnRay(int x, int screenWidth, float rayDistance) const;
+  void castColumn(int x, int screenWidth, float rayDistance);
+  bool reprojectColumn(int x, int screenWidth, float rayDistance);
+  void applyMapChanges();
+  bool isTileOccupied(Vec2i tile);
+  void clearColumns(int from, int to);
+  void drawColumns(int from, int to, float rayDistance);
+  void collectSprites();
+  bool getSpriteChanges(int& from, int& to);
+  void cacheSprites();
+  void drawSprites(int from, int to);
+  void renderSky(int from, int to);
+  void renderSurfaces(float rayDistance, int from, int to);
+  void drawWallLayer(int x, float rayAngle, const RayHit& hit, int& windowBottom, bool seeThrough = false);
+  void drawSeeThroughOver(int x, float depth);
+  void drawSpriteSpan(Texture* texture, int textureX, int textureY, int textureHeight, int x, int y, int height);
   void processInput(float frameTime);
 } raycaster;
 
@@ -111,6 +195,26 @@ void Raycaster::init() {
   raycaster.res.textureOverlay = Texture(getResourcePath(RES_TEXTURE, config.getValueOrDie("texture", "overlay", "test.overlay is required")));
 
   depthBuffer = new float[getWidth()];
+  columnHits.resize(getWidth() * MAX_WALL_LAYERS);
+  columnLayers.resize(getWidth());
+  columnSeeThrough.resize(getWidth());
+  seeThroughDepth.resize(getWidth());
+
+  surfaceBuffer = Texture(getWidth(), getHeight(), TEXTURE_STREAMING);
+  surfacePixels.resize(getWidth() * getHeight());
+  columnDirections.resize(getWidth());
+  columnStretch.resize(getWidth());
+  columnNearest.resize(getWidth());
+
+  columnGrainSize = std::stoi(config.getValueOr("jobs", "column_grain", "32"));
+  interlacedColumns = config.getValueOr("window", "interlaced_columns", "0") != "0";
+  frameCache = config.getValueOr("window", "frame_cache", "0") != "0";
+
+  viewWidth = getWidth();
+  viewHeight = getHeight();
+  viewBuffer = Texture(getWidth(), getHeight());
+  dynamicResolution = config.getValueOr("window", "dynamic_resolution", "0") != "0";
+  minResolutionScale = std::clamp(std::stof(config.getValueOr("window", "min_resolution_scale", "0.5")), 0.1f, 1.0f);
 }
 
 bool Raycaster::onFrameUpdate(float frameTime) {
@@ -148,21 +252,59 @@ void Raycaster::loadMap(const std::string& name) {
   
   unloadMap();
 
-  for (auto &textureName : res.map.textures) {
-    res.textures.push_back(Texture(getResourcePath(RES_TEXTURE, textureName)));
+  // Floor and ceiling textures are sampled on the CPU and need their pixels kept around
+  std::vector<bool> surfaceTextures(res.map.textures.size(), false);
+  for (auto& tile : res.map.tiles) {
+    if (tile.floorTexture < surfaceTextures.size()) {
+      surfaceTextures[tile.floorTexture] = true;
+    }
+    if (tile.ceilingTexture < surfaceTextures.size()) {
+      surfaceTextures[tile.ceilingTexture] = true;
+    }
+  }
+
+  for (size_t i = 0; i < res.map.textures.size(); i++) {
+    int flags = i && surfaceTextures[i] ? TEXTURE_KEEP_PIXELS : 0;
+    res.textures.push_back(Texture(getResourcePath(RES_TEXTURE, res.map.textures[i]), flags));
+  }
+  texturedSurfaces = res.map.hasSurfaces();
+
+  if (!res.map.sky.empty()) {
+    res.sky = Texture(getResourcePath(RES_TEXTURE, res.map.sky));
   }
 
   for (auto &spriteName : res.map.sprites) {
-    res.sprites.push_back(Texture(getResourcePath(RES_SPRITE, spriteName)));
+    res.sprites.push_back(Texture(getResourcePath(RES_SPRITE, spriteName), TEXTURE_OPAQUE_SPANS));
   }
 
+  // Maps saved without a bake get one here, it only lives as long as the map
+  if (!res.map.lights.empty() && !res.map.hasLightmap()) {
+    bakeLightmap(res.map);
+  }
+
+  maxWallHeight = 1;
+  for (auto& tile : res.map.tiles) {
+    if (tile.isSolid()) {
+      maxWallHeight = std::max(maxWallHeight, tile.getWallHeight());
+    }
+  }
+
+  lights.reset(res.map);
+  shades.build(res.map.fog);
+
+  doors.reset(res.map);
+  columnHistoryWidth = 0;
+  worldDirty = true;
+  objects.setBounds(res.map.width, res.map.height);
+  nav.reset(res.map, player.position);
+
   for (MapObject& object : res.map.objects) {
     float x = (float)object.x+0.5f;
     float y = (float)object.y+0.5f;
-    objects.push_back({ 0, std::unique_ptr<GameObject>(new GameObject({x, y}, &res.sprites[object.sprite])) });
+    objects.create(OBJTYPE_STATIONARY, {x, y}, {0, 0}, object.sprite);
   }
 
-  // objects.push_back({ 0, std::unique_ptr<GameObject>(new GameObject({(float)res.map.width/2 + 0.5f, (float)res.map.height/2 + 0.5f}, &res.sprites[1])) });
+  // objects.create(OBJTYPE_STATIONARY, {(float)res.map.width/2 + 0.5f, (float)res.map.height/2 + 0.5f}, {0, 0}, 1);
 
   info("Map '%s' loaded successfully.", res.map.name.c_str());
 
@@ -171,10 +313,15 @@ void Raycaster::loadMap(const std::string& name) {
 
 void Raycaster::unloadMap() {
   res.textures.clear();
+  res.sky = Texture();
   res.sprites.clear();
+  objects.clear();
 }
 
 void Raycaster::onConsoleCommand(std::string line) {
+  // Commands can change anything about the view, the next frame is drawn from scratch
+  worldDirty = true;
+
   auto tokens = splitstr(line);
 
   if (!tokens.empty()) {
@@ -231,6 +378,59 @@ void Raycaster::onConsoleCommand(std::string line) {
       profile = !profile;
     } else if (tokens[0] == "spriteoverlay") {
       spriteOverlay = !spriteOverlay;
+    } else if (tokens[0] == "fog") {
+      MapFog fog;
+      int r = 0, g = 0, b = 0;
+      if (tokens.size() == 2 && tokens[1] == "off") {
+        res.map.fog = fog;
+        shades.build(fog);
+      } else if (tokens.size() == 6 && rayc::stoi(tokens[1], r) && rayc::stoi(tokens[2], g) && rayc::stoi(tokens[3], b)
+          && rayc::stof(tokens[4], fog.start) && rayc::stof(tokens[5], fog.end)) {
+        fog.enabled = true;
+        fog.r = r;
+        fog.g = g;
+        fog.b = b;
+        res.map.fog = fog;
+        shades.build(fog);
+      } else {
+        printConsole(RGB_RED, "Usage: fog off | fog R G B START END");
+      }
+    } else if (tokens[0] == "light") {
+      float intensity = 0, radius = 0;
+      if (tokens.size() == 3 && rayc::stof(tokens[1], intensity) && rayc::stof(tokens[2], radius)) {
+        lights.add(player.position, intensity, radius);
+      } else {
+        printConsole(RGB_RED, "Usage: light INTENSITY RADIUS");
+      }
+    } else if (tokens[0] == "tile") {
+      int x = 0, y = 0, texture = 0, height = 0;
+      if ((tokens.size() == 4 || tokens.size() == 5) && rayc::stoi(tokens[1], x) && rayc::stoi(tokens[2], y) && rayc::stoi(tokens[3], texture)
+          && (tokens.size() == 4 || rayc::stoi(tokens[4], height)) && res.map.contains(x, y) && texture >= 0 && texture < (int)res.textures.size()) {
+        MapTile tile = res.map.getTile(x, y);
+        tile.flags = 0;
+        tile.texture = texture;
+        tile.height = height;
+        tile.doorState = DOOR_CLOSED;
+        tile.openedPercent = 0;
+        res.map.setTile({x, y}, tile);
+      } else {
+        printConsole(RGB_RED, "Usage: tile X Y TEXTURE [HEIGHT]");
+      }
+    } else if (tokens[0] == "framecache") {
+      frameCache = !frameCache;
+    } else if (tokens[0] == "interlace") {
+      interlacedColumns = !interlacedColumns;
+    } else if (tokens[0] == "dynres") {
+      if (tokens.size() == 2 && (tokens[1] == "on" || tokens[1] == "off")) {
+        dynamicResolution = tokens[1] == "on";
+        resolutionScale = 1.0f;
+        resolutionRenderTime = 0.0f;
+        resolutionFrames = 0;
+      } else if (tokens.size() == 1) {
+        printConsole(RGB_WHITE, dynamicResolution ? std::to_string(viewWidth) + "x" + std::to_string(viewHeight) : "off");
+      } else {
+        printConsole(RGB_RED, "Usage: dynres [on|off]");
+      }
     } else if (tokens[0] == "fpscap") {
       if (tokens.size() == 1) {
         printConsole(RGB_WHITE, std::to_string(getFpsCap()));
@@ -250,155 +450,24 @@ void Raycaster::onConsoleCommand(std::string line) {
   }
 }
 
-Raycaster::DDAResult Raycaster::castRay(Vec2d src, Vec2d direction) {
-  Raycaster::DDAResult result;
-
-  Vec2d rayDelta = {
-    sqrt(1 + (direction.y / direction.x) * (direction.y / direction.x)),
-    sqrt(1 + (direction.x / direction.y) * (direction.x / direction.y))
-  };
-
-  Vec2i mapCheck = {(int)src.x, (int)src.y};
-  Vec2d sideDistance, stepDistance;
-
-  if (direction.x < 0) {
-    stepDistance.x = -1;
-    sideDistance.x = (src.x - (float)mapCheck.x) * rayDelta.x;
-  } else {
-    stepDistance.x = 1;
-    sideDistance.x = ((float)mapCheck.x + 1 - src.x) * rayDelta.x;
-  }
-
-  if (direction.y < 0) {
-    stepDistance.y = -1;
-    sideDistance.y = (src.y - (float)mapCheck.y) * rayDelta.y;
-  } else {
-    stepDistance.y = 1;
-    sideDistance.y = ((float)mapCheck.y + 1 - src.y) * rayDelta.y;
-  }
-
-  Vec2d intersection;
-  Vec2i hitTile;
-  float maxDistance = 100.0f;
-  float distance = 0.0f;
-  // bool tileFound = false;
-  TileHit hit;
-
-  while (!result.hitWall && distance < maxDistance) {
-    if (sideDistance.x < sideDistance.y) {
-      sideDistance.x += rayDelta.x;
-      mapCheck.x += stepDistance.x;
-    } else {
-      sideDistance.y += rayDelta.y;
-      mapCheck.y += stepDistance.y;
-    }
-
-    Vec2d rayDistance = {(float)mapCheck.x - src.x, (float)mapCheck.y - src.y};
-    distance = sqrt(rayDistance.x * rayDistance.x + rayDistance.y * rayDistance.y);
-
-    if (res.map.getTile(mapCheck).isSolid()) {
-      hitTile = mapCheck;
-
-      if (res.map.getTile(mapCheck).isDoor() && res.map.getTile(mapCheck).doorState != DOOR_CLOSED) {
-        // tileFound = false;
-        result.hitDoor = true;
-      } else {
-        // tileFound = true;
-        result.hitWall = true;
-      }
-
-      hit.tilePosition = mapCheck;
-
-      float m = direction.y / direction.x;
-
-      if (src.y <= mapCheck.y) {
-        if (src.x <= mapCheck.x) {
-          hit.side = WEST;
-          intersection.y = m * (mapCheck.x - src.x) + src.y;
-          intersection.x = float(mapCheck.x);
-          hit.sampleX = intersection.y - std::floor(intersection.y);
-        } else if (src.x >= (mapCheck.x + 1)) {
-          hit.side = EAST;
-          intersection.y = m * ((mapCheck.x + 1) - src.x) + src.y;
-          intersection.x = float(mapCheck.x + 1);
-          hit.sampleX = intersection.y - std::floor(intersection.y);
-        } else {
-          hit.side = NORTH;
-          intersection.y = float(mapCheck.y);
-          intersection.x = (mapCheck.y - src.y) / m + src.x;
-          hit.sampleX = intersection.x - std::floor(intersection.x);
-        }
-
-        if (intersection.y < mapCheck.y) {
-          hit.side = NORTH;
-          intersection.y = float(mapCheck.y);
-          intersection.x = (mapCheck.y - src.y) / m + src.x;
-          hit.sampleX = intersection.x - std::floor(intersection.x);
-        }
-      } else if (src.y >= mapCheck.y + 1) {
-        if (src.x <= mapCheck.x) {
-          hit.side = WEST;
-          intersection.y = m * (mapCheck.x - src.x) + src.y;
-          intersection.x = float(mapCheck.x);
-          hit.sampleX = intersection.y - std::floor(intersection.y);
-        } else if (src.x >= (mapCheck.x + 1)) {
-          hit.side = EAST;
-          intersection.y = m * ((mapCheck.x + 1) - src.x) + src.y;
-          intersection.x = float(mapCheck.x + 1);
-          hit.sampleX = intersection.y - std::floor(intersection.y);
-        } else {
-          hit.side = SOUTH;
-          intersection.y = float(mapCheck.y + 1);
-          intersection.x = ((mapCheck.y + 1) - src.y) / m + src.x;
-          hit.sampleX = intersection.x - std::floor(intersection.x);
-        }
-
-        if (intersection.y > (mapCheck.y + 1)) {
-          hit.side = SOUTH;
-          intersection.y = float(mapCheck.y + 1);
-          intersection.x = ((mapCheck.y + 1) - src.y) / m + src.x;
-          hit.sampleX = intersection.x - std::floor(intersection.x);
-        }
-      } else {
-        if (src.x <= mapCheck.x) {
-          hit.side = WEST;
-          intersection.y = m * (mapCheck.x - src.x) + src.y;
-          intersection.x = float(mapCheck.x);
-          hit.sampleX = intersection.y - std::floor(intersection.y);
-        } else if (src.x >= (mapCheck.x + 1)) {
-          hit.side = EAST;
-          intersection.y = m * ((mapCheck.x + 1) - src.x) + src.y;
-          intersection.x = float(mapCheck.x + 1);
-          hit.sampleX = intersection.y - std::floor(intersection.y);
-        }
-      }
-
-      hit.hitPosition = intersection;
-
-      if (res.map.getTile(mapCheck).isDoor() && res.map.getTile(mapCheck).doorState != DOOR_CLOSED) {
-        result.door = hit;
-      } else {
-        result.tile = hit;
-      }
-    }
-  }
-
-  return result;
-}
-
 void Raycaster::render(float frameTime) {
   auto start = std::chrono::system_clock::now();
 
-  clearBuffer();
+  float scale = dynamicResolution ? resolutionScale : 1.0f;
+  viewWidth = std::max((int)(getWidth() * scale), 1);
+  viewHeight = std::max((int)(getHeight() * scale), 1);
+
+  // The world goes through viewBuffer whenever it is scaled or kept for the next frame
+  bool offscreen = dynamicResolution || frameCache;
+  if (offscreen) {
+    setBuffer(&viewBuffer);
+  }
 
-  int screenHeight = getHeight();
-  int screenWidth = getWidth();
+  int screenHeight = viewHeight;
+  int screenWidth = viewWidth;
   int mapHeight = res.map.height;
   int mapWidth = res.map.width;
 
-  setDrawColor(128, 128, 128, 255);
-  fillRect({0, screenHeight/2, screenWidth, screenHeight/2});
-
   // Vec2d forward = {
   //   cos(player.angle),
   //   sin(player.angle)
@@ -502,109 +571,100 @@ void Raycaster::render(float frameTime) {
   //   );
   // }
 
-  for (int x = 0; x < screenWidth; x++) {
-    float rayAngle = (player.angle - fov/2.0f) + (x / (float)screenWidth) * fov;
-    Vec2d rayDirection = {sinf(rayAngle), cosf(rayAngle)};
-
-    DDAResult result = castRay(player.position, rayDirection);
-
-    if (result.hitWall) {
-      Vec2d ray = result.tile.hitPosition - player.position;
-      float rayLength = sqrt(ray.x * ray.x + ray.y * ray.y) * cos(rayAngle - player.angle);
+  // Only moving doors are visited, and only their state changes reach the caches built from the map
+  doors.update(res.map, frameTime, [this](Vec2i tile) { return isTileOccupied(tile); });
+  for (auto& event : doors.getEvents()) {
+    nav.setWalkable(event.tile, res.map.getTile(event.tile).isPassable());
+    lights.invalidateTile(event.tile);
+  }
+  doors.clearEvents();
 
-      depthBuffer[x] = rayLength;
+  bool mapChanged = !res.map.getChanges().empty();
+  applyMapChanges();
+  int relit = lights.update(player.position);
 
-      float ceiling = (screenHeight/2.0f) - screenHeight / rayLength;
-      float floor = screenHeight - ceiling;
-      float wallHeight = floor - ceiling;
+  // Geometry past the fog end is invisible, so it isn't traced either
+  float rayDistance = shades.getCutoff(depth);
 
-      int textureIdx = res.map.getTile(result.tile.tilePosition).texture;
-      Texture* texture = &res.texturePlaceholder;
-      if (textureIdx >= 0 && textureIdx < res.textures.size()) {
-        texture = &res.textures[textureIdx];
-      }
+  FrameSignature signature = {player.position, player.angle, fov, rayDistance, screenWidth, screenHeight};
+  bool redraw = !frameCache || worldDirty || !(signature == lastSignature) || mapChanged || relit || doors.getMovingCount();
+  redrawnColumns = redraw ? screenWidth : 0;
 
-      float whole;
-      int textureX = std::modf(result.tile.sampleX, &whole) * texture->getWidth();
+  if (redraw) {
+    // Rays only read the map, so they are cast on the pool and drawn here afterwards
+    bool interlace = interlacedColumns && columnHistoryWidth == screenWidth;
+    int parity = columnParity;
 
-      if (result.tile.side == SOUTH || result.tile.side == WEST) {
-        textureX = texture->getWidth() - textureX - 1;
+    jobs::parallelFor(0, screenWidth, columnGrainSize, [this, screenWidth, rayDistance, interlace, parity](int from, int to) {
+      for (int x = from; x < to; x++) {
+        if (!interlace || (x & 1) == parity) {
+          castColumn(x, screenWidth, rayDistance);
+        }
       }
-
-      copyTexture(texture, {textureX, 0, 1, texture->getHeight()}, {x, (int)ceiling, 1, (int)wallHeight});
+    });
+
+    // Only reads the columns cast above and writes the others, so it can run on the pool as well
+    if (interlace) {
+      jobs::parallelFor(0, screenWidth, columnGrainSize, [this, screenWidth, rayDistance, parity](int from, int to) {
+        for (int x = from; x < to; x++) {
+          if ((x & 1) != parity && !reprojectColumn(x, screenWidth, rayDistance)) {
+            castColumn(x, screenWidth, rayDistance);
+          }
+        }
+      });
     }
 
+    // History from another width, a turned off mode or another map is useless, everything was cast
+    columnHistoryWidth = interlacedColumns ? screenWidth : 0;
+    columnParity ^= 1;
+
+    clearColumns(0, screenWidth);
+    drawColumns(0, screenWidth, rayDistance);
   }
 
   auto wallRenderEnd = std::chrono::system_clock::now();
   auto objectRenderStart = std::chrono::system_clock::now();
 
-  for (auto &pair : objects) {
-    pair.second->onFrameUpdate(frameTime);
-    
-    if (res.map.getTile(pair.second->position.x, pair.second->position.y).isSolid()) {
-      pair.second->onCollision(nullptr);
-    }
-
-    Vec2d vec = pair.second->position - player.position;
-    Vec2d direction = {sinf(player.angle), cosf(player.angle)};
+  // NPCs chase the player through the last finished field while the next one is built
+  nav.setGoal(player.position);
+  nav.update();
+  objects.update(res.map, frameTime, &nav.getField(), player.position);
 
-    float objectAngle = atan2f(direction.y, direction.x) - atan2f(vec.y, vec.x);
-    float distanceFromPlayer = sqrtf(vec.x*vec.x + vec.y*vec.y) * cosf(objectAngle);
-    pair.first = distanceFromPlayer;
+  collectSprites();
 
-    if (objectAngle < -M_PI) {
-      objectAngle += 2.0f * M_PI;
-    }
-
-    if (objectAngle > M_PI) {
-      objectAngle -= 2.0f * M_PI;
+  // Same view as last frame: only the columns under sprites that moved, appeared or vanished are redrawn
+  int spritesFrom = 0, spritesTo = screenWidth;
+  if (!redraw) {
+    if (getSpriteChanges(spritesFrom, spritesTo)) {
+      clearColumns(spritesFrom, spritesTo);
+      drawColumns(spritesFrom, spritesTo, rayDistance);
+      redrawnColumns = spritesTo - spritesFrom;
+    } else {
+      spritesTo = spritesFrom;
     }
+  }
 
-    bool isInFov = fabs(objectAngle) < (fov + (1.0f / distanceFromPlayer)) / 2.0f;
-
-    if (isInFov && distanceFromPlayer >= 0.5f && distanceFromPlayer < depth) {
-      Vec2d floorPoint = {
-        (0.5f * ((objectAngle / (fov * 0.5f))) + 0.5f) * screenWidth,
-        (screenHeight / 2.0f) + (screenHeight / distanceFromPlayer) / std::cos(objectAngle / 2.0f)
-      };
-
-      Vec2d objectSize = {(double)pair.second->texture->getWidth(), (double)pair.second->texture->getHeight()};
-      objectSize *= 2.0f * screenHeight/objectSize.y;
-      objectSize /= distanceFromPlayer;
-
-      Vec2i start = {(int)(floorPoint.x - objectSize.x / 2.0f), (int)(floorPoint.y - objectSize.y + 100.0f/distanceFromPlayer)};
-
-      float whole;
-
-      // printf("obj: sz=(%f %f) a=%f d=%f st=(%d %d)\n", objectSize.x, objectSize.y, objectAngle, distanceFromPlayer, start.x, start.y);
+  if (spritesFrom < spritesTo) {
+    drawSprites(spritesFrom, spritesTo);
+  }
 
-      for (int sx = 0; sx < objectSize.x; sx++) {
-        int textureX = (sx / objectSize.x) * pair.second->texture->getWidth();
+  cacheSprites();
+  lastSignature = signature;
+  worldDirty = false;
 
-        if (depthBuffer[start.x + sx] >= distanceFromPlayer) {
-          copyTexture(pair.second->texture,
-            {textureX, 0, 1, pair.second->texture->getHeight()},
-            {start.x+sx, start.y, 1, (int)objectSize.y}
-          );
+  auto objectRenderEnd = std::chrono::system_clock::now();
 
-          if (spriteOverlay) {
-            copyTexture(&res.textureOverlay,
-              {textureX, 0, 1, pair.second->texture->getHeight()},
-              {start.x+sx, start.y, 1, (int)objectSize.y}
-            );
-          }
-        }
-      }
-    }
+  if (offscreen) {
+    setBuffer(nullptr);
+    copyTexture(&viewBuffer, {0, 0, viewWidth, viewHeight}, Rect());
+  }
 
-    objects.remove_if([](auto& p) { return p.second->remove; });
-    objects.sort([](const auto& a, const auto& b) { return a.first > b.first; });
+  if (dynamicResolution) {
+    std::chrono::duration<float> renderDuration = objectRenderEnd - start;
+    updateResolution(renderDuration.count());
   }
 
   if (profile) {
-    auto objectRenderEnd = std::chrono::system_clock::now();
-
     std::chrono::duration<float> renderDuration = objectRenderEnd - start;
     float renderTime = renderDuration.count();
 
@@ -651,12 +711,604 @@ void Raycaster::render(float frameTime) {
     // printBuffer();
     snprintf(buffer, 32, "objectRenderTime: %8f", objectRenderTime);
     printBuffer();
+    snprintf(buffer, 32, "resolution: %dx%d", viewWidth, viewHeight);
+    printBuffer();
+    snprintf(buffer, 32, "redrawnColumns: %d", redrawnColumns);
+    printBuffer();
   }
 
   // delete [] loopTime;
   // delete [] whileCount;
 }
 
+void Raycaster::collectSprites() {
+  int screenHeight = viewHeight;
+  int screenWidth = viewWidth;
+
+  Vec2d forward = {sinf(player.angle), cosf(player.angle)};
+  Vec2d right = {forward.y, -forward.x};
+  float halfFovTan = tanf(fov / 2.0f);
+
+  visibleSprites.clear();
+  depthSummary.build(depthBuffer, screenWidth);
+
+  const MapVisibility& visibility = res.map.visibility;
+  int viewerCluster = visibility.getCluster(player.position);
+
+  for (int type = 0; type < OBJTYPE_COUNT; type++) {
+    const ObjectPool& pool = objects.getPool((GameObjectType)type);
+
+    spriteCandidates.clear();
+    spritePositions.clear();
+
+    for (size_t i = 0; i < pool.size(); i++) {
+      if (!(pool.flags[i] & OBJFLAG_VISIBLE) || pool.sprite[i] >= res.sprites.size()) {
+        continue;
+      }
+
+      // Behind walls for sure, not even worth the transform
+      if (!visibility.canSeeCluster(viewerCluster, visibility.getCluster(pool.position[i]))) {
+        continue;
+      }
+
+      spriteCandidates.push_back(i);
+      spritePositions.push_back(pool.position[i]);
+    }
+
+    // Camera space of the remaining candidates in one batch, sprites are at most a tile wide
+    size_t count = spriteCandidates.size();
+    spriteDepths.resize(count);
+    spriteLaterals.resize(count);
+    transformPoints(spritePositions.data(), count, player.position, forward, right, spriteDepths.data(), spriteLaterals.data());
+
+    for (size_t candidate = 0; candidate < count; candidate++) {
+      size_t i = spriteCandidates[candidate];
+      float distanceFromPlayer = spriteDepths[candidate];
+      float lateral = spriteLaterals[candidate];
+
+      if (distanceFromPlayer < 0.5f || distanceFromPlayer >= depth) {
+        continue;
+      }
+
+      if (fabs(lateral) > distanceFromPlayer * halfFovTan + 1.0f) {
+        continue;
+      }
+
+      // Columns are spread evenly by angle, so the sprite is placed by angle too
+      float objectAngle = atan2f(lateral, distanceFromPlayer);
+      Texture* texture = &res.sprites[pool.sprite[i]];
+
+      Vec2d floorPoint = {
+        (0.5f * ((objectAngle / (fov * 0.5f))) + 0.5f) * screenWidth,
+        (screenHeight / 2.0f) + (screenHeight / distanceFromPlayer) / std::cos(objectAngle / 2.0f)
+      };
+
+      Vec2d objectSize = {(double)texture->getWidth(), (double)texture->getHeight()};
+      objectSize *= 2.0f * screenHeight/objectSize.y;
+      objectSize /= distanceFromPlayer;
+
+      SpriteInstance sprite;
+      sprite.depth = distanceFromPlayer;
+      sprite.sprite = pool.sprite[i];
+      sprite.object = pool.slot[i];
+      sprite.light = shades.lookupDimmed(distanceFromPlayer, lights.getLight(pool.position[i]));
+      sprite.x = floorPoint.x - objectSize.x / 2.0f;
+      sprite.y = floorPoint.y - objectSize.y + 100.0f/distanceFromPlayer;
+      sprite.width = std::ceil(objectSize.x);
+      sprite.height = objectSize.y;
+      sprite.left = std::max(sprite.x, 0);
+      sprite.right = std::min(sprite.x + sprite.width, screenWidth);
+
+      if (sprite.left >= sprite.right || sprite.height <= 0) {
+        continue;
+      }
+
+      if (depthSummary.isOccluded(sprite.left, sprite.right, distanceFromPlayer)) {
+        continue;
+      }
+
+      visibleSprites.push_back(sprite);
+    }
+  }
+
+  sortSpritesBackToFront(visibleSprites, spriteScratch, depth);
+}
+
+static bool isSameSprite(const SpriteInstance& a, const SpriteInstance& b) {
+  return a.sprite == b.sprite && a.light == b.light && a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
+
+// Column range covering every sprite that isn't drawn exactly as in the cached frame, false when there is none
+// Sprites are matched to the cached ones through their object slot, so this stays linear
+bool Raycaster::getSpriteChanges(int& from, int& to) {
+  from = viewWidth;
+  to = 0;
+
+  auto include = [&from, &to](const SpriteInstance& sprite) {
+    from = std::min(from, sprite.left);
+    to = std::max(to, sprite.right);
+  };
+
+  cachedMatched.assign(cachedSprites.size(), 0);
+
+  for (auto& sprite : visibleSprites) {
+    uint32_t cached = sprite.object < cachedSlots.size() ? cachedSlots[sprite.object] : 0;
+    if (cached && isSameSprite(sprite, cachedSprites[cached - 1])) {
+      cachedMatched[cached - 1] = 1;
+    } else {
+      include(sprite);
+    }
+  }
+
+  // Gone or changed since the cached frame
+  for (size_t i = 0; i < cachedSprites.size(); i++) {
+    if (!cachedMatched[i]) {
+      include(cachedSprites[i]);
+    }
+  }
+
+  return from < to;
+}
+
+void Raycaster::cacheSprites() {
+  for (auto& sprite : cachedSprites) {
+    cachedSlots[sprite.object] = 0;
+  }
+
+  cachedSprites = visibleSprites;
+  for (size_t i = 0; i < cachedSprites.size(); i++) {
+    if (cachedSprites[i].object >= cachedSlots.size()) {
+      cachedSlots.resize(cachedSprites[i].object + 1, 0);
+    }
+    cachedSlots[cachedSprites[i].object] = i + 1;
+  }
+}
+
+void Raycaster::drawSprites(int from, int to) {
+  int screenHeight = viewHeight;
+
+  for (auto& sprite : visibleSprites) {
+    int left = std::max(sprite.left, from);
+    int right = std::min(sprite.right, to);
+    if (left >= right) {
+      continue;
+    }
+
+    Texture* texture = &res.sprites[sprite.sprite];
+    texture->setColorMod(sprite.light, sprite.light, sprite.light);
+
+    bool unoccluded = depthSummary.isUnoccluded(left, right, sprite.depth);
+
+    for (int x = left; x < right; x++) {
+      if (!unoccluded && depthBuffer[x] < sprite.depth) {
+        continue;
+      }
+
+      int textureX = ((x - sprite.x) / (float)sprite.width) * texture->getWidth();
+
+      if (!texture->hasSpans()) {
+        drawSpriteSpan(texture, textureX, 0, texture->getHeight(), x, sprite.y, sprite.height);
+        drawSeeThroughOver(x, sprite.depth);
+        continue;
+      }
+
+      // Only the opaque runs of the column are blitted, empty columns cost nothing
+      const TextureSpan* spans = texture->getSpans(textureX);
+      int spanCount = texture->getSpanCount(textureX);
+
+      for (int i = 0; i < spanCount; i++) {
+        int top = sprite.y + spans[i].start * sprite.height / texture->getHeight();
+        int bottom = sprite.y + spans[i].end * sprite.height / texture->getHeight();
+
+        if (bottom <= 0) {
+          continue;
+        }
+
+        if (top >= screenHeight) {
+          break;
+        }
+
+        drawSpriteSpan(texture, textureX, spans[i].start, spans[i].end - spans[i].start, x, top, bottom - top);
+      }
+      drawSeeThroughOver(x, sprite.depth);
+    }
+  }
+}
+
+// Windows and fences were drawn before the sprites, the ones in front of a sprite go back over it.
+// Sprites come back to front, so a nearer sprite still covers them afterwards
+void Raycaster::drawSeeThroughOver(int x, float depth) {
+  if (seeThroughDepth[x] >= depth) {
+    return;
+  }
+
+  float rayAngle = (player.angle - fov/2.0f) + (x / (float)viewWidth) * fov;
+  const SeeThroughHits& seeThrough = columnSeeThrough[x];
+
+  // The sprite is in front of every opaque wall here, so nothing clips these
+  for (int i = seeThrough.count - 1; i >= 0; i--) {
+    const RayHit& hit = seeThrough.hits[i];
+    if (hit.distance * cos(rayAngle - player.angle) < depth) {
+      int clip = viewHeight;
+      drawWallLayer(x, rayAngle, hit, clip, true);
+    }
+  }
+}
+
+Ray Raycaster::getColumnRay(int x, int screenWidth, float rayDistance) const {
+  float rayAngle = (player.angle - fov/2.0f) + (x / (float)screenWidth) * fov;
+
+  Ray ray;
+  ray.origin = player.position;
+  ray.direction = {sinf(rayAngle), cosf(rayAngle)};
+  ray.maxDistance = rayDistance;
+  return ray;
+}
+
+void Raycaster::castColumn(int x, int screenWidth, float rayDistance) {
+  float rayAngle = (player.angle - fov/2.0f) + (x / (float)screenWidth) * fov;
+  Ray ray = getColumnRay(x, screenWidth, rayDistance);
+  float coveredSlope = getCoveredSlope(rayAngle, player.angle);
+  columnLayers[x] = castRayLayers(res.map, ray, COLUMN_EYE_HEIGHT, coveredSlope, maxWallHeight, &columnHits[x * MAX_WALL_LAYERS], MAX_WALL_LAYERS, &columnSeeThrough[x]);
+}
+
+bool Raycaster::reprojectColumn(int x, int screenWidth, float rayDistance) {
+  Ray ray = getColumnRay(x, screenWidth, rayDistance);
+  return rayc::reprojectColumn(ray, columnHits.data(), columnLayers.data(), columnSeeThrough.data(), x, screenWidth);
+}
+
+// Steps the scale toward a render time that leaves room for the rest of the frame under the fps cap,
+// with a dead band between the two thresholds so it doesn't flip back and forth
+void Raycaster::updateResolution(float renderTime) {
+  resolutionRenderTime += renderTime;
+  if (++resolutionFrames < RESOLUTION_WINDOW) {
+    return;
+  }
+
+  float average = resolutionRenderTime / resolutionFrames;
+  float budget = 0.8f / getFpsCap();
+  resolutionRenderTime = 0.0f;
+  resolutionFrames = 0;
+
+  if (average > budget) {
+    // Render time scales with the pixel count, so the side length goes with its square root
+    resolutionScale *= std::max(std::sqrt(budget / average), 0.75f);
+  } else if (average < budget * 0.6f) {
+    resolutionScale *= 1.05f;
+  }
+  resolutionScale = std::clamp(resolutionScale, minResolutionScale, 1.0f);
+}
+
+// The player or any object whose circle reaches into the tile
+bool Raycaster::isTileOccupied(Vec2i tile) {
+  if ((Vec2i)player.position == tile) {
+    return true;
+  }
+
+  doorOccupants.clear();
+  objects.getSpatialHash().queryRadius({tile.x + 0.5, tile.y + 0.5}, M_SQRT1_2, doorOccupants);
+
+  for (auto& handle : doorOccupants) {
+    Vec2d position = objects.getPosition(handle);
+    Vec2d nearest = {std::clamp(position.x, (double)tile.x, tile.x + 1.0), std::clamp(position.y, (double)tile.y, tile.y + 1.0)};
+    Vec2d offset = position - nearest;
+    float radius = objects.getRadius(handle);
+
+    if (offset.dot(offset) < radius * radius) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Brings everything built from the map up to date with this tick's edits, only around the edited tiles
+void Raycaster::applyMapChanges() {
+  auto& changes = res.map.getChanges();
+  if (changes.empty()) {
+    return;
+  }
+
+  MapRegion relit;
+  for (Vec2i position : changes) {
+    const MapTile& tile = res.map.getTile(position);
+
+    nav.setWalkable(position, tile.isPassable());
+    lights.invalidateTile(position);
+    relit.include(getStaticLightReach(res.map, position));
+
+    if (tile.isSolid()) {
+      maxWallHeight = std::max(maxWallHeight, tile.getWallHeight());
+    } else {
+      res.map.visibility.openCluster(res.map.visibility.getCluster(position));
+    }
+  }
+
+  bakeLightmap(res.map, relit);
+  lights.resampleStatic(relit);
+
+  // Interlaced columns would carry hits on faces that may not exist any more
+  columnHistoryWidth = 0;
+
+  res.map.clearChanges();
+}
+
+// Sky, floor and ceiling, then the walls of columns [from, to) from the hits cast earlier
+void Raycaster::drawColumns(int from, int to, float rayDistance) {
+  int screenHeight = viewHeight;
+  int screenWidth = viewWidth;
+
+  if (res.sky.getSdlTexture()) {
+    renderSky(from, to);
+  }
+
+  if (texturedSurfaces) {
+    renderSurfaces(rayDistance, from, to);
+  }
+
+  for (int x = from; x < to; x++) {
+    float rayAngle = (player.angle - fov/2.0f) + (x / (float)screenWidth) * fov;
+
+    // Rows below windowBottom are already covered by nearer walls
+    int windowBottom = screenHeight;
+    const RayHit* layers = &columnHits[x * MAX_WALL_LAYERS];
+
+    depthBuffer[x] = std::numeric_limits<float>::max();
+    if (columnLayers[x]) {
+      depthBuffer[x] = layers[0].distance * cos(rayAngle - player.angle);
+    }
+
+    seeThroughDepth[x] = std::numeric_limits<float>::max();
+    if (columnSeeThrough[x].count) {
+      seeThroughDepth[x] = columnSeeThrough[x].hits[0].distance * cos(rayAngle - player.angle);
+    }
+
+    // windows[i] is what is still open behind the i nearest walls
+    int windows[MAX_WALL_LAYERS + 1] = {windowBottom};
+    int drawn = 0;
+    for (; drawn < columnLayers[x] && windowBottom > 0; drawn++) {
+      drawWallLayer(x, rayAngle, layers[drawn], windowBottom);
+      windows[drawn + 1] = windowBottom;
+    }
+
+    // See-through tiles go back to front over the walls, each clipped only by the walls in front of it
+    const SeeThroughHits& seeThrough = columnSeeThrough[x];
+    for (int i = seeThrough.count - 1; i >= 0; i--) {
+      const RayHit& hit = seeThrough.hits[i];
+
+      int nearer = 0;
+      while (nearer < drawn && layers[nearer].distance < hit.distance) {
+        nearer++;
+      }
+
+      int clip = windows[nearer];
+      if (clip > 0) {
+        drawWallLayer(x, rayAngle, hit, clip, true);
+      }
+    }
+
+    // Colored fog hides whatever is past the cut-off behind a wall of fog
+    if (shades.hasOverlay() && windowBottom > 0) {
+      const MapFog& fog = shades.getFog();
+      float ceiling = (screenHeight/2.0f) - screenHeight / (rayDistance * cos(rayAngle - player.angle));
+      int bottom = std::min((int)(screenHeight - ceiling), windowBottom);
+      setDrawColor(fog.r, fog.g, fog.b);
+      fillRect({x, (int)ceiling, 1, bottom - (int)ceiling});
+    }
+  }
+}
+
+void Raycaster::clearColumns(int from, int to) {
+  setDrawColor(0, 0, 0, 255);
+  fillRect({from, 0, to - from, viewHeight});
+
+  if (!texturedSurfaces) {
+    setDrawColor(128, 128, 128, 255);
+    fillRect({from, viewHeight/2, to - from, viewHeight/2});
+  }
+}
+
+void Raycaster::renderSky(int from, int to) {
+  int screenHeight = viewHeight;
+  int screenWidth = viewWidth;
+  int textureWidth = res.sky.getWidth();
+
+  if ((int)skyColumns.size() != screenWidth || skyFov != fov || skyWidth != textureWidth) {
+    skyColumns.resize(screenWidth);
+    for (int x = 0; x < screenWidth; x++) {
+      skyColumns[x] = (-fov/2.0f + (x / (float)screenWidth) * fov) / (2.0f * M_PI) * textureWidth;
+    }
+    skyFov = fov;
+    skyWidth = textureWidth;
+  }
+
+  float horizon = screenHeight / 2.0f;
+  float base = player.angle / (2.0f * M_PI) * textureWidth;
+
+  for (int x = from; x < to; x++) {
+    // Layers come out in rising order, so the last one has the highest top
+    float bottom = horizon;
+    if (columnLayers[x]) {
+      float rayAngle = (player.angle - fov/2.0f) + (x / (float)screenWidth) * fov;
+      const RayHit& hit = columnHits[x * MAX_WALL_LAYERS + columnLayers[x] - 1];
+      float rayLength = hit.distance * cos(rayAngle - player.angle);
+      int wallHeight = res.map.getTile(hit.tile).getWallHeight();
+      bottom = std::min(bottom, horizon + screenHeight / rayLength - wallHeight * 2.0f * screenHeight / rayLength);
+    }
+
+    if (bottom <= 0) {
+      continue;
+    }
+
+    int textureX = ((int)std::floor(base + skyColumns[x]) % textureWidth + textureWidth) % textureWidth;
+    int textureHeight = std::max((int)(bottom / horizon * res.sky.getHeight()), 1);
+    copyTexture(&res.sky, {textureX, 0, 1, textureHeight}, {x, 0, 1, (int)bottom});
+  }
+}
+
+static inline uint32_t shadePixel(uint32_t pixel, const Shade& shade, const MapFog& fog) {
+  uint32_t r = (pixel >> 24) * shade.r / 255;
+  uint32_t g = (pixel >> 16 & 0xff) * shade.g / 255;
+  uint32_t b = (pixel >> 8 & 0xff) * shade.b / 255;
+
+  if (shade.fog) {
+    r = (r * (255 - shade.fog) + fog.r * shade.fog) / 255;
+    g = (g * (255 - shade.fog) + fog.g * shade.fog) / 255;
+    b = (b * (255 - shade.fog) + fog.b * shade.fog) / 255;
+  }
+
+  return r << 24 | g << 16 | b << 8 | 0xff;
+}
+
+void Raycaster::renderSurfaces(float rayDistance, int from, int to) {
+  int screenHeight = viewHeight;
+  int screenWidth = viewWidth;
+
+  // Columns are spread by angle, so each keeps its own ray scaled to one tile of perpendicular depth
+  for (int x = from; x < to; x++) {
+    float rayAngle = (player.angle - fov/2.0f) + (x / (float)screenWidth) * fov;
+    float perpendicular = cos(rayAngle - player.angle);
+
+    columnDirections[x] = {sinf(rayAngle) / perpendicular, cosf(rayAngle) / perpendicular};
+    columnStretch[x] = 1.0f / perpendicular;
+    columnNearest[x] = columnLayers[x] ? columnHits[x * MAX_WALL_LAYERS].distance * perpendicular : std::numeric_limits<float>::max();
+  }
+
+  int columnsFrom = from, columnsTo = to;
+  jobs::parallelFor(0, screenHeight, 16, [this, screenWidth, screenHeight, rayDistance, columnsFrom, columnsTo](int from, int to) {
+    const MapFog& fog = shades.getFog();
+    float horizon = screenHeight / 2.0f;
+    bool sky = res.sky.getSdlTexture();
+
+    for (int y = from; y < to; y++) {
+      bool ceiling = y < horizon;
+      uint32_t flat = ceiling ? 0x000000ff : 0x808080ff;
+      uint32_t* row = &surfacePixels[y * screenWidth];
+
+      // Mirrors the wall projection: a floor row y shows depth screenHeight / (y - horizon)
+      float rowDepth = screenHeight / std::fabs(y + 0.5f - horizon);
+      if (fog.enabled && rowDepth > rayDistance) {
+        std::fill(row + columnsFrom, row + columnsTo, shadePixel(flat, shades.lookup(rayDistance, 255), fog));
+        continue;
+      }
+
+      for (int x = columnsFrom; x < columnsTo; x++) {
+        // The nearest wall is drawn over this pixel anyway
+        if (rowDepth >= columnNearest[x]) {
+          continue;
+        }
+
+        Vec2d point = player.position + columnDirections[x] * (double)rowDepth;
+        Vec2i tilePosition = {(int)std::floor(point.x), (int)std::floor(point.y)};
+
+        uint32_t pixel = flat;
+        uint8_t light = 255;
+
+        if (res.map.contains(tilePosition)) {
+          const MapTile& tile = res.map.getTile(tilePosition);
+          int textureIdx = ceiling ? tile.ceilingTexture : tile.floorTexture;
+
+          // Open to the sky, leave the pixel see-through
+          if (ceiling && !textureIdx && sky) {
+            row[x] = 0;
+            continue;
+          }
+
+          const uint32_t* pixels = textureIdx && textureIdx < (int)res.textures.size() ? res.textures[textureIdx].getPixels() : nullptr;
+          if (pixels) {
+            const Texture& texture = res.textures[textureIdx];
+            int u = std::min((int)((point.x - tilePosition.x) * texture.getWidth()), texture.getWidth() - 1);
+            int v = std::min((int)((point.y - tilePosition.y) * texture.getHeight()), texture.getHeight() - 1);
+            pixel = pixels[v * texture.getWidth() + u];
+          }
+
+          light = lights.getLight(tilePosition);
+        }
+
+        row[x] = shadePixel(pixel, shades.lookup(rowDepth * columnStretch[x], light), fog);
+      }
+    }
+  });
+
+  surfaceBuffer.update(&surfacePixels[from], {from, 0, to - from, screenHeight}, screenWidth);
+  copyTexture(&surfaceBuffer, {from, 0, to - from, screenHeight}, {from, 0, to - from, screenHeight});
+}
+
+void Raycaster::drawWallLayer(int x, float rayAngle, const RayHit& hit, int& windowBottom, bool seeThrough) {
+  int screenHeight = viewHeight;
+
+  float rayLength = hit.distance * cos(rayAngle - player.angle);
+  float unitHeight = 2.0f * screenHeight / rayLength;
+  float floor = (screenHeight/2.0f) + screenHeight / rayLength;
+
+  const MapTile& tile = res.map.getTile(hit.tile);
+  Texture* texture = &res.texturePlaceholder;
+  if (tile.texture < res.textures.size()) {
+    texture = &res.textures[tile.texture];
+  }
+
+  float whole;
+  int textureX = std::modf(hit.sampleX, &whole) * texture->getWidth();
+
+  if (hit.side == SIDE_SOUTH || hit.side == SIDE_WEST) {
+    textureX = texture->getWidth() - textureX - 1;
+  }
+
+  uint8_t light = lights.getFaceLight(hit.tile, hit.side);
+  const Shade& shade = shades.lookup(hit.distance, light);
+  if (seeThrough && shade.fog) {
+    // The overlay would close the holes, so the fog goes into the color mod like for sprites
+    uint8_t dimmed = shades.lookupDimmed(hit.distance, light);
+    texture->setColorMod(dimmed, dimmed, dimmed);
+  } else {
+    texture->setColorMod(shade.r, shade.g, shade.b);
+  }
+
+  // The texture repeats once per tile of height, bottom up, each copy clipped to the open window
+  for (int level = 0; level < tile.getWallHeight(); level++) {
+    float bottom = floor - level * unitHeight;
+    float top = bottom - unitHeight;
+
+    if (bottom <= 0) {
+      break;
+    }
+
+    float visibleTop = std::max(top, 0.0f);
+    float visibleBottom = std::min(bottom, (float)windowBottom);
+    if (visibleTop >= visibleBottom) {
+      continue;
+    }
+
+    int textureY = (visibleTop - top) / unitHeight * texture->getHeight();
+    int textureHeight = std::max((int)((visibleBottom - visibleTop) / unitHeight * texture->getHeight()), 1);
+
+    copyTexture(texture, {textureX, textureY, 1, textureHeight}, {x, (int)visibleTop, 1, (int)(visibleBottom - visibleTop)});
+
+    // The overlay is a solid fill and would close the holes
+    if (shade.fog && !seeThrough) {
+      const MapFog& fog = shades.getFog();
+      setDrawColor(fog.r, fog.g, fog.b, shade.fog);
+      fillRect({x, (int)visibleTop, 1, (int)(visibleBottom - visibleTop)});
+    }
+  }
+
+  windowBottom = std::min(windowBottom, (int)std::max(floor - tile.getWallHeight() * unitHeight, 0.0f));
+}
+
+void Raycaster::drawSpriteSpan(Texture* texture, int textureX, int textureY, int textureHeight, int x, int y, int height) {
+  copyTexture(texture,
+    {textureX, textureY, 1, textureHeight},
+    {x, y, 1, height}
+  );
+
+  if (spriteOverlay) {
+    copyTexture(&res.textureOverlay,
+      {textureX, textureY, 1, textureHeight},
+      {x, y, 1, height}
+    );
+  }
+}
+
 void Raycaster::processInput(float frameTime) {
   // if (getKeyState(SDL_SCANCODE_LEFT).held) {
   //   player.angle += rotationSpeed * frameTime;
@@ -730,7 +1382,7 @@ void Raycaster::processInput(float frameTime) {
     player.position.x += sinf(player.angle) * movementSpeed * frameTime;
     player.position.y += cosf(player.angle) * movementSpeed * frameTime;
 
-    if (res.map.getTile((int)player.position.x, (int)player.position.y).isSolid()) {
+    if (!res.map.getTile((int)player.position.x, (int)player.position.y).isPassable()) {
       player.position.x -= sinf(player.angle) * movementSpeed * frameTime;
       player.position.y -= cosf(player.angle) * movementSpeed * frameTime;
     }
@@ -740,7 +1392,7 @@ void Raycaster::processInput(float frameTime) {
     player.position.x -= sinf(player.angle) * movementSpeed * frameTime;
     player.position.y -= cosf(player.angle) * movementSpeed * frameTime;
 
-    if (res.map.getTile((int)player.position.x, (int)player.position.y).isSolid()) {
+    if (!res.map.getTile((int)player.position.x, (int)player.position.y).isPassable()) {
       player.position.x += sinf(player.angle) * movementSpeed * frameTime;
       player.position.y += cosf(player.angle) * movementSpeed * frameTime;
     }
@@ -750,7 +1402,7 @@ void Raycaster::processInput(float frameTime) {
     player.position.x -= cosf(player.angle) * movementSpeed * frameTime;
     player.position.y += sinf(player.angle) * movementSpeed * frameTime;
 
-    if (res.map.getTile((int)player.position.x, (int)player.position.y).isSolid()) {
+    if (!res.map.getTile((int)player.position.x, (int)player.position.y).isPassable()) {
       player.position.x += cosf(player.angle) * movementSpeed * frameTime;
       player.position.y -= sinf(player.angle) * movementSpeed * frameTime;
     }
@@ -760,11 +1412,24 @@ void Raycaster::processInput(float frameTime) {
     player.position.x += cosf(player.angle) * movementSpeed * frameTime;
     player.position.y -= sinf(player.angle) * movementSpeed * frameTime;
 
-    if (res.map.getTile((int)player.position.x, (int)player.position.y).isSolid()) {
+    if (!res.map.getTile((int)player.position.x, (int)player.position.y).isPassable()) {
       player.position.x -= cosf(player.angle) * movementSpeed * frameTime;
       player.position.y += sinf(player.angle) * movementSpeed * frameTime;
     }
   }
+
+  if (getKeyState(SDL_SCANCODE_E).pressed) {
+    Ray ray;
+    ray.origin = player.position;
+    ray.direction = {sinf(player.angle), cosf(player.angle)};
+    ray.maxDistance = 1.5f;
+    ray.flags = RAY_BLOCK_OPEN_DOORS;
+
+    RayHit hit = castRay(res.map, ray);
+    if (hit.type == RAYHIT_DOOR) {
+      doors.open(res.map, hit.tile);
+    }
+  }
 }
 
 bool onFrameUpdateCb(float frameTime) {
@@ -793,6 +1458,8 @@ int main(int argc, char ** argv) {
 
     raycaster.config = Config::fromFile(getResourcePath(RES_RAYC_CONFIG));
 
+    jobs::init(std::stoi(raycaster.config.getValueOr("jobs", "workers", "-1")));
+
     init(
       std::stoi(raycaster.config.getValueOr("window", "width", "800")),
       std::stoi(raycaster.config.getValueOr("window", "height", "600"))
@@ -804,6 +1471,7 @@ int main(int argc, char ** argv) {
     raycaster.init();
     run(onFrameUpdateCb, onConsoleCommandCb);
     shutdown();
+    jobs::shutdown();
 
     return 0;
 
@@ -0,0 +1,362 @@
+#include <rayc/raycast.h>
+#include <rayc/object.h>
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+static void setTileHit(rayc::RayHit& hit, const rayc::Ray& ray, rayc::Vec2d direction, const rayc::RayDDA& dda, rayc::RayHitType type) {
+  hit.type = type;
+  hit.distance = dda.getDistance();
+  hit.point = ray.origin + direction * dda.getDistance();
+  hit.tile = dda.tile;
+  hit.side = dda.entrySide;
+
+  double along = hit.side == rayc::SIDE_WEST || hit.side == rayc::SIDE_EAST ? hit.point.y : hit.point.x;
+  hit.sampleX = along - std::floor(along);
+}
+
+enum TileTrace {
+  TRACE_PASS,
+  TRACE_SEETHROUGH,
+  TRACE_BLOCK,
+};
+
+static double getDoorOpening(const rayc::MapTile& tile) {
+  return tile.doorState == rayc::DOOR_OPENED ? 1.0 : tile.openedPercent / 100.0;
+}
+
+// Doors are a thin panel across the middle of their tile, the open part slides out of the way
+static bool traceDoor(rayc::RayHit& hit, const rayc::MapTile& tile, const rayc::Ray& ray, rayc::Vec2d direction, const rayc::RayDDA& dda, double opening) {
+  bool vertical = tile.isVDoor();
+  double axisOrigin = vertical ? ray.origin.x : ray.origin.y;
+  double axisDirection = vertical ? direction.x : direction.y;
+  double plane = (vertical ? dda.tile.x : dda.tile.y) + 0.5;
+
+  if (axisDirection == 0) {
+    return false;
+  }
+
+  double distance = (plane - axisOrigin) / axisDirection;
+  if (distance < 0) {
+    return false;
+  }
+
+  rayc::Vec2d point = ray.origin + direction * distance;
+  double along = vertical ? point.y - dda.tile.y : point.x - dda.tile.x;
+
+  // Leaving through a side of the tile before reaching the panel, or through the opened part
+  if (along < 0 || along >= 1 || along < opening) {
+    return false;
+  }
+
+  hit.type = rayc::RAYHIT_DOOR;
+  hit.distance = distance;
+  hit.point = point;
+  hit.tile = dda.tile;
+  if (vertical) {
+    hit.side = direction.x > 0 ? rayc::SIDE_WEST : rayc::SIDE_EAST;
+  } else {
+    hit.side = direction.y > 0 ? rayc::SIDE_NORTH : rayc::SIDE_SOUTH;
+  }
+  hit.sampleX = along - opening;
+  return true;
+}
+
+static TileTrace traceTile(rayc::RayHit& hit, const rayc::MapTile& tile, const rayc::Ray& ray, rayc::Vec2d direction, const rayc::RayDDA& dda) {
+  if (!tile.isSolid()) {
+    return TRACE_PASS;
+  }
+
+  if (tile.isDoor()) {
+    if (ray.flags & rayc::RAY_IGNORE_DOORS) {
+      return TRACE_PASS;
+    }
+
+    double opening = ray.flags & rayc::RAY_BLOCK_OPEN_DOORS ? 0.0 : getDoorOpening(tile);
+    return traceDoor(hit, tile, ray, direction, dda, opening) ? TRACE_BLOCK : TRACE_PASS;
+  }
+
+  setTileHit(hit, ray, direction, dda, rayc::RAYHIT_WALL);
+
+  if (tile.isSeeThrough() && !(ray.flags & rayc::RAY_STOP_SEETHROUGH)) {
+    return TRACE_SEETHROUGH;
+  }
+  return TRACE_BLOCK;
+}
+
+rayc::RayHit rayc::castRay(const Map& map, const Ray& ray, const ObjectStore* objects) {
+  RayHit hit;
+
+  double length = std::sqrt(ray.direction.dot(ray.direction));
+  if (length == 0) {
+    return hit;
+  }
+  Vec2d direction = ray.direction / length;
+
+  RayDDA dda(ray.origin, direction);
+  RayScalar maxDistance = ScalarTraits<RayScalar>::fromDouble(ray.maxDistance);
+  hit.distance = ray.maxDistance;
+
+  while (true) {
+    dda.advance();
+
+    if (dda.distance > maxDistance) {
+      break;
+    }
+
+    if (!map.contains(dda.tile)) {
+      hit.distance = dda.getDistance();
+      break;
+    }
+
+    RayHit candidate;
+    if (traceTile(candidate, map.getTile(dda.tile), ray, direction, dda) == TRACE_BLOCK) {
+      if (candidate.distance <= ray.maxDistance) {
+        hit = candidate;
+      }
+      break;
+    }
+  }
+
+  if (hit.type == RAYHIT_NONE) {
+    hit.point = ray.origin + direction * (double)hit.distance;
+  }
+
+  if (objects && ray.flags & RAY_HIT_OBJECTS) {
+    ObjectHandle object;
+    float distance;
+
+    // The wall distance caps the search, so objects behind it are never visited
+    if (objects->getSpatialHash().queryRay(ray.origin, direction, hit.distance, object, distance, ray.ignore)) {
+      hit = {};
+      hit.type = RAYHIT_OBJECT;
+      hit.distance = distance;
+      hit.point = ray.origin + direction * (double)distance;
+      hit.object = object;
+    }
+  }
+
+  return hit;
+}
+
+int rayc::castRayLayers(const Map& map, const Ray& ray, float eyeHeight, float coveredSlope, float maxHeight, RayHit* hits, int capacity, SeeThroughHits* seeThrough) {
+  if (seeThrough) {
+    seeThrough->count = 0;
+  }
+
+  double length = std::sqrt(ray.direction.dot(ray.direction));
+  if (length == 0) {
+    return 0;
+  }
+  Vec2d direction = ray.direction / length;
+
+  RayDDA dda(ray.origin, direction);
+  RayScalar maxDistance = ScalarTraits<RayScalar>::fromDouble(ray.maxDistance);
+  double visibleSlope = -std::numeric_limits<double>::infinity();
+  int count = 0;
+
+  while (count < capacity) {
+    dda.advance();
+
+    if (dda.distance > maxDistance || !map.contains(dda.tile)) {
+      break;
+    }
+
+    const MapTile& tile = map.getTile(dda.tile);
+    RayHit candidate;
+    TileTrace trace = traceTile(candidate, tile, ray, direction, dda);
+    if (trace == TRACE_PASS) {
+      continue;
+    }
+
+    // Everything stands on the floor, so a wall shows only if its top rises above the nearer ones
+    double distance = std::max((double)candidate.distance, 0.0001);
+    double slope = (tile.getWallHeight() - eyeHeight) / distance;
+    if (slope <= visibleSlope) {
+      continue;
+    }
+
+    if (trace == TRACE_SEETHROUGH) {
+      if (seeThrough && seeThrough->count < SeeThroughHits::CAPACITY) {
+        seeThrough->hits[seeThrough->count++] = candidate;
+      }
+      continue;
+    }
+
+    visibleSlope = slope;
+    hits[count++] = candidate;
+
+    // Column covered, or not even the tallest wall in the map could show over this one any more
+    if (visibleSlope >= coveredSlope || (maxHeight - eyeHeight) / distance <= visibleSlope) {
+      break;
+    }
+  }
+
+  return count;
+}
+
+void rayc::castRays(const Map& map, const Ray* rays, RayHit* hits, size_t count, const ObjectStore* objects) {
+  for (size_t i = 0; i < count; i++) {
+    hits[i] = castRay(map, rays[i], objects);
+  }
+}
+
+bool rayc::hasLineOfSight(const Map& map, Vec2d from, Vec2d to, uint8_t flags) {
+  Vec2d delta = to - from;
+
+  Ray ray;
+  ray.origin = from;
+  ray.direction = delta;
+  ray.maxDistance = std::sqrt(delta.dot(delta));
+  ray.flags = flags & ~RAY_HIT_OBJECTS;
+
+  return castRay(map, ray).type == RAYHIT_NONE;
+}
+
+bool rayc::reprojectHit(const Ray& ray, RayHit& hit) {
+  if (hit.type != RAYHIT_WALL) {
+    return false;
+  }
+
+  double length = std::sqrt(ray.direction.dot(ray.direction));
+  if (length == 0) {
+    return false;
+  }
+  Vec2d direction = ray.direction / length;
+
+  // The face has to be entered through, i.e. the ray moves into the tile across it
+  bool vertical = hit.side == SIDE_WEST || hit.side == SIDE_EAST;
+  double axisOrigin = vertical ? ray.origin.x : ray.origin.y;
+  double axisDirection = vertical ? direction.x : direction.y;
+  bool positive = hit.side == SIDE_WEST || hit.side == SIDE_NORTH;
+
+  if (positive ? axisDirection <= 0 : axisDirection >= 0) {
+    return false;
+  }
+
+  double plane = (vertical ? hit.tile.x : hit.tile.y) + (positive ? 0 : 1);
+  double distance = (plane - axisOrigin) / axisDirection;
+  if (distance <= 0 || distance > ray.maxDistance) {
+    return false;
+  }
+
+  Vec2d point = ray.origin + direction * distance;
+  double along = vertical ? point.y : point.x;
+  int tileAlong = vertical ? hit.tile.y : hit.tile.x;
+  if (along < tileAlong || along >= tileAlong + 1) {
+    return false;
+  }
+
+  hit.distance = distance;
+  hit.point = point;
+  hit.sampleX = along - std::floor(along);
+  return true;
+}
+
+float rayc::getCoveredSlope(float rayAngle, float viewAngle) {
+  return 0.25f * cos(rayAngle - viewAngle);
+}
+
+// With both neighbours hitting the same face and nothing over it, anything in between would have
+// to be thinner than a column
+bool rayc::canReprojectColumn(const RayHit* hits, const uint8_t* layers, const SeeThroughHits* seeThrough, int x, int width) {
+  if (x == 0 || x == width - 1) {
+    return false;
+  }
+
+  for (int i = x - 1; i <= x + 1; i++) {
+    if (layers[i] != 1 || seeThrough[i].count) {
+      return false;
+    }
+  }
+
+  const RayHit& left = hits[(x - 1) * COLUMN_MAX_LAYERS];
+  const RayHit& right = hits[(x + 1) * COLUMN_MAX_LAYERS];
+  const RayHit& hit = hits[x * COLUMN_MAX_LAYERS];
+
+  if (hit.type != RAYHIT_WALL || left.type != RAYHIT_WALL || right.type != RAYHIT_WALL) {
+    return false;
+  }
+
+  return hit.tile == left.tile && hit.tile == right.tile && hit.side == left.side && hit.side == right.side;
+}
+
+bool rayc::reprojectColumn(const Ray& ray, RayHit* hits, const uint8_t* layers, const SeeThroughHits* seeThrough, int x, int width) {
+  if (!canReprojectColumn(hits, layers, seeThrough, x, width)) {
+    return false;
+  }
+
+  RayHit hit = hits[x * COLUMN_MAX_LAYERS];
+  if (!reprojectHit(ray, hit)) {
+    return false;
+  }
+
+  hits[x * COLUMN_MAX_LAYERS] = hit;
+  return true;
+}
+
+rayc::RayBatch::~RayBatch() {
+  wait();
+}
+
+size_t rayc::RayBatch::add(const Ray& ray) {
+  wait();
+  m_rays.push_back(ray);
+  return m_rays.size() - 1;
+}
+
+void rayc::RayBatch::clear() {
+  wait();
+  m_rays.clear();
+  m_hits.clear();
+}
+
+size_t rayc::RayBatch::size() const {
+  return m_rays.size();
+}
+
+void rayc::RayBatch::submit(const Map& map, const ObjectStore* objects, int grainSize) {
+  wait();
+
+  size_t count = m_rays.size();
+  m_hits.resize(count);
+
+  if (!count) {
+    return;
+  }
+
+  grainSize = std::max(grainSize, 1);
+
+  std::vector<jobs::JobHandle> chunks;
+  chunks.reserve(count / grainSize + 1);
+
+  const Map* source = &map;
+  for (size_t from = 0; from < count; from += grainSize) {
+    size_t to = std::min(from + grainSize, count);
+    chunks.push_back(jobs::submit([this, source, objects, from, to]() {
+      castRays(*source, &m_rays[from], &m_hits[from], to - from, objects);
+    }));
+  }
+
+  m_job = jobs::submit([]() {}, chunks);
+}
+
+bool rayc::RayBatch::isFinished() const {
+  return !m_job || m_job->finished;
+}
+
+void rayc::RayBatch::wait() {
+  if (m_job) {
+    jobs::wait(m_job);
+    m_job.reset();
+  }
+}
+
+const rayc::RayHit& rayc::RayBatch::getHit(size_t index) const {
+  return m_hits[index];
+}
+
+const std::vector<rayc::RayHit>& rayc::RayBatch::getHits() const {
+  return m_hits;
+}
@@ -0,0 +1,297 @@
+#include <rayc/reference.h>
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+static const uint32_t CEILING_COLOR = 0xff383838;
+static const uint32_t FLOOR_COLOR = 0xff707070;
+static const int TEXELS = 64;
+
+enum TileTrace {
+  TRACE_PASS,
+  TRACE_SEETHROUGH,
+  TRACE_BLOCK,
+};
+
+static void setTileHit(rayc::RayHit& hit, const rayc::Ray& ray, rayc::Vec2d direction, const rayc::GridDDA& dda, rayc::RayHitType type) {
+  hit.type = type;
+  hit.distance = dda.distance;
+  hit.point = ray.origin + direction * dda.distance;
+  hit.tile = dda.tile;
+  hit.side = dda.entrySide;
+
+  double along = hit.side == rayc::SIDE_WEST || hit.side == rayc::SIDE_EAST ? hit.point.y : hit.point.x;
+  hit.sampleX = along - std::floor(along);
+}
+
+static bool traceDoor(rayc::RayHit& hit, const rayc::MapTile& tile, const rayc::Ray& ray, rayc::Vec2d direction, const rayc::GridDDA& dda, double opening) {
+  bool vertical = tile.isVDoor();
+  double axisOrigin = vertical ? ray.origin.x : ray.origin.y;
+  double axisDirection = vertical ? direction.x : direction.y;
+  double plane = (vertical ? dda.tile.x : dda.tile.y) + 0.5;
+
+  if (axisDirection == 0) {
+    return false;
+  }
+
+  double distance = (plane - axisOrigin) / axisDirection;
+  if (distance < 0) {
+    return false;
+  }
+
+  rayc::Vec2d point = ray.origin + direction * distance;
+  double along = vertical ? point.y - dda.tile.y : point.x - dda.tile.x;
+
+  if (along < 0 || along >= 1 || along < opening) {
+    return false;
+  }
+
+  hit.type = rayc::RAYHIT_DOOR;
+  hit.distance = distance;
+  hit.point = point;
+  hit.tile = dda.tile;
+  if (vertical) {
+    hit.side = direction.x > 0 ? rayc::SIDE_WEST : rayc::SIDE_EAST;
+  } else {
+    hit.side = direction.y > 0 ? rayc::SIDE_NORTH : rayc::SIDE_SOUTH;
+  }
+  hit.sampleX = along - opening;
+  return true;
+}
+
+static TileTrace traceTile(rayc::RayHit& hit, const rayc::MapTile& tile, const rayc::Ray& ray, rayc::Vec2d direction, const rayc::GridDDA& dda) {
+  if (!tile.isSolid()) {
+    return TRACE_PASS;
+  }
+
+  if (tile.isDoor()) {
+    if (ray.flags & rayc::RAY_IGNORE_DOORS) {
+      return TRACE_PASS;
+    }
+
+    double opening = 0.0;
+    if (!(ray.flags & rayc::RAY_BLOCK_OPEN_DOORS)) {
+      opening = tile.doorState == rayc::DOOR_OPENED ? 1.0 : tile.openedPercent / 100.0;
+    }
+    return traceDoor(hit, tile, ray, direction, dda, opening) ? TRACE_BLOCK : TRACE_PASS;
+  }
+
+  setTileHit(hit, ray, direction, dda, rayc::RAYHIT_WALL);
+
+  if (tile.isSeeThrough() && !(ray.flags & rayc::RAY_STOP_SEETHROUGH)) {
+    return TRACE_SEETHROUGH;
+  }
+  return TRACE_BLOCK;
+}
+
+rayc::RayHit rayc::reference::castRay(const Map& map, const Ray& ray) {
+  RayHit hit;
+
+  double length = std::sqrt(ray.direction.dot(ray.direction));
+  if (length == 0) {
+    return hit;
+  }
+  Vec2d direction = ray.direction / length;
+
+  GridDDA dda(ray.origin, direction);
+  hit.distance = ray.maxDistance;
+
+  while (true) {
+    dda.advance();
+
+    if (dda.distance > ray.maxDistance) {
+      break;
+    }
+
+    if (!map.contains(dda.tile)) {
+      hit.distance = dda.distance;
+      break;
+    }
+
+    RayHit candidate;
+    if (traceTile(candidate, map.getTile(dda.tile), ray, direction, dda) == TRACE_BLOCK) {
+      if (candidate.distance <= ray.maxDistance) {
+        hit = candidate;
+      }
+      break;
+    }
+  }
+
+  if (hit.type == RAYHIT_NONE) {
+    hit.point = ray.origin + direction * (double)hit.distance;
+  }
+
+  return hit;
+}
+
+int rayc::reference::castRayLayers(const Map& map, const Ray& ray, float eyeHeight, float coveredSlope, float maxHeight, RayHit* hits, int capacity) {
+  double length = std::sqrt(ray.direction.dot(ray.direction));
+  if (length == 0) {
+    return 0;
+  }
+  Vec2d direction = ray.direction / length;
+
+  GridDDA dda(ray.origin, direction);
+  double visibleSlope = -std::numeric_limits<double>::infinity();
+  int count = 0;
+
+  while (count < capacity) {
+    dda.advance();
+
+    if (dda.distance > ray.maxDistance || !map.contains(dda.tile)) {
+      break;
+    }
+
+    const MapTile& tile = map.getTile(dda.tile);
+    RayHit candidate;
+    TileTrace trace = traceTile(candidate, tile, ray, direction, dda);
+    if (trace == TRACE_PASS) {
+      continue;
+    }
+
+    double distance = std::max((double)candidate.distance, 0.0001);
+    double slope = (tile.getWallHeight() - eyeHeight) / distance;
+    if (slope <= visibleSlope || trace == TRACE_SEETHROUGH) {
+      continue;
+    }
+
+    visibleSlope = slope;
+    hits[count++] = candidate;
+
+    if (visibleSlope >= coveredSlope || (maxHeight - eyeHeight) / distance <= visibleSlope) {
+      break;
+    }
+  }
+
+  return count;
+}
+
+// Cheap integer hash, neighbouring inputs end up far apart
+static uint32_t hashColor(uint32_t value) {
+  value ^= value >> 16;
+  value *= 0x7feb352d;
+  value ^= value >> 15;
+  value *= 0x846ca68b;
+  value ^= value >> 16;
+  return value | 0xff000000;
+}
+
+static uint32_t shadeColor(uint32_t color, float distance) {
+  float light = 1.0f / (1.0f + distance * 0.1f);
+  uint32_t r = ((color >> 16) & 0xff) * light;
+  uint32_t g = ((color >> 8) & 0xff) * light;
+  uint32_t b = (color & 0xff) * light;
+  return 0xff000000 | (r << 16) | (g << 8) | b;
+}
+
+rayc::reference::Frame::Frame(int width, int height)
+  : width(width), height(height), pixels(width * height), depth(width) {}
+
+void rayc::reference::Frame::clear() {
+  for (int y = 0; y < height; y++) {
+    std::fill(pixels.begin() + y * width, pixels.begin() + (y + 1) * width, y < height / 2 ? CEILING_COLOR : FLOOR_COLOR);
+  }
+  std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::infinity());
+}
+
+uint32_t rayc::reference::Frame::getPixel(int x, int y) const {
+  return pixels[y * width + x];
+}
+
+float rayc::reference::getColumnAngle(const View& view, int x, int width) {
+  return (view.angle - view.fov/2.0f) + (x / (float)width) * view.fov;
+}
+
+rayc::Ray rayc::reference::getColumnRay(const View& view, int x, int width) {
+  float rayAngle = getColumnAngle(view, x, width);
+
+  Ray ray;
+  ray.origin = view.position;
+  ray.direction = {sinf(rayAngle), cosf(rayAngle)};
+  ray.maxDistance = view.rayDistance;
+  return ray;
+}
+
+float rayc::reference::getCoveredSlope(const View& view, int x, int width) {
+  return rayc::getCoveredSlope(getColumnAngle(view, x, width), view.angle);
+}
+
+void rayc::reference::drawColumn(Frame& frame, const Map& map, const View& view, int x, const RayHit* hits, int count) {
+  float rayAngle = getColumnAngle(view, x, frame.width);
+  int windowBottom = frame.height;
+
+  for (int i = 0; i < count; i++) {
+    const RayHit& hit = hits[i];
+    const MapTile& tile = map.getTile(hit.tile);
+
+    float rayLength = hit.distance * cos(rayAngle - view.angle);
+    float unitHeight = 2.0f * frame.height / rayLength;
+    float floor = (frame.height/2.0f) + frame.height / rayLength;
+
+    if (i == 0) {
+      frame.depth[x] = rayLength;
+    }
+
+    int texel = hit.sampleX * TEXELS;
+    if (hit.side == SIDE_SOUTH || hit.side == SIDE_WEST) {
+      texel = TEXELS - texel - 1;
+    }
+    uint32_t color = shadeColor(hashColor((tile.texture << 16) | (hit.side << 8) | texel), hit.distance);
+
+    for (int level = 0; level < tile.getWallHeight(); level++) {
+      float bottom = floor - level * unitHeight;
+      float top = bottom - unitHeight;
+
+      if (bottom <= 0) {
+        break;
+      }
+
+      float visibleTop = std::max(top, 0.0f);
+      float visibleBottom = std::min(bottom, (float)windowBottom);
+      if (visibleTop >= visibleBottom) {
+        continue;
+      }
+
+      int from = visibleTop, to = from + (int)(visibleBottom - visibleTop);
+      for (int y = from; y < std::min(to, frame.height); y++) {
+        frame.pixels[y * frame.width + x] = color;
+      }
+    }
+
+    windowBottom = std::min(windowBottom, (int)std::max(floor - tile.getWallHeight() * unitHeight, 0.0f));
+  }
+}
+
+// Half a tile wide and standing on the floor, placed by angle like the game's sprites
+void rayc::reference::drawSprites(Frame& frame, const View& view, const Sprite* sprites, size_t count) {
+  float halfFovTan = tanf(view.fov / 2.0f);
+
+  for (size_t i = 0; i < count; i++) {
+    const Sprite& sprite = sprites[i];
+
+    if (sprite.depth < 0.5f || sprite.depth >= view.rayDistance || fabs(sprite.lateral) > sprite.depth * halfFovTan + 1.0f) {
+      continue;
+    }
+
+    float objectAngle = atan2f(sprite.lateral, sprite.depth);
+    float centerX = (0.5f * (objectAngle / (view.fov * 0.5f)) + 0.5f) * frame.width;
+    float floorY = (frame.height / 2.0f) + (frame.height / sprite.depth) / std::cos(objectAngle / 2.0f);
+    float size = frame.height / sprite.depth;
+
+    int left = std::max((int)(centerX - size / 2.0f), 0);
+    int right = std::min((int)(centerX + size / 2.0f), frame.width);
+    int top = std::max((int)(floorY - size), 0);
+    int bottom = std::min((int)floorY, frame.height);
+
+    uint32_t color = shadeColor(hashColor(0x80000000 | sprite.id), sprite.depth);
+    for (int x = left; x < right; x++) {
+      if (sprite.depth >= frame.depth[x]) {
+        continue;
+      }
+      for (int y = top; y < bottom; y++) {
+        frame.pixels[y * frame.width + x] = color;
+      }
+    }
+  }
+}
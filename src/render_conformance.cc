@@ -0,0 +1,359 @@
+#include <rayc/map.h>
+#include <rayc/log.h>
+#include <rayc/jobs.h>
+#include <rayc/raycast.h>
+#include <rayc/reference.h>
+#include <rayc/math/batch.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <algorithm>
+
+using namespace rayc;
+
+struct Options {
+  int width = 320;
+  int height = 200;
+  int poses = 32;
+  int tolerance = 8;            // per channel
+  double maxBadColumns = 0.005; // share of all compared columns
+  int reportColumns = 4;        // listed per mismatching frame
+  int grainSize = 32;
+};
+
+// Column hits for a whole frame, the way the game keeps them
+struct ColumnHits {
+  std::vector<RayHit> hits;
+  std::vector<uint8_t> layers;
+  std::vector<SeeThroughHits> seeThrough; // optimized path only, not drawn
+
+  void resize(int width) {
+    hits.assign(width * COLUMN_MAX_LAYERS, RayHit());
+    layers.assign(width, 0);
+    seeThrough.assign(width, SeeThroughHits());
+  }
+
+  RayHit* get(int x) { return &hits[x * COLUMN_MAX_LAYERS]; }
+};
+
+struct Scene {
+  std::string name;
+  Map map;
+  float maxHeight = 1.0f;
+  std::vector<Vec2d> sprites;
+};
+
+struct Pose {
+  reference::View view;
+  reference::View previous; // a moment earlier, for the interlaced path
+};
+
+// Rooms of mixed wall heights split by walls with doorways, some of them half open doors or windows
+static Scene generateScene(int size, std::mt19937& rng) {
+  Scene scene;
+  scene.name = "generated/" + std::to_string(size);
+  scene.map = Map(size, size);
+  Map& map = scene.map;
+
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      bool border = x == 0 || y == 0 || x == size - 1 || y == size - 1;
+      map.getTile(x, y) = {0, (uint8_t)(border ? 1 : 0), 1};
+    }
+  }
+
+  for (int wall = 8; wall < size - 1; wall += 8) {
+    for (int i = 1; i < size - 1; i++) {
+      MapTile& vertical = map.getTile(wall, i);
+      MapTile& horizontal = map.getTile(i, wall);
+      int kind = rng() % 16;
+
+      for (MapTile* tile : {&vertical, &horizontal}) {
+        if (kind < 10) {
+          *tile = {0, (uint8_t)(1 + rng() % 4), (uint8_t)(1 + rng() % 3)};
+        } else if (kind < 12) {
+          *tile = {TILE_SEETHROUGH, 5, 1};
+        } else if (kind < 14) {
+          *tile = {(uint8_t)(tile == &vertical ? TILE_VDOOR : TILE_HDOOR), 6, 1};
+          tile->doorState = DOOR_OPENING;
+          tile->openedPercent = rng() % 100;
+        } else {
+          *tile = {0, 0, 1};
+        }
+      }
+    }
+  }
+
+  // Free standing pillars, tall ones so walls behind them still show over the top
+  for (int i = 0; i < size * size / 40; i++) {
+    int x = 1 + rng() % (size - 2), y = 1 + rng() % (size - 2);
+    if (x % 8 && y % 8) {
+      map.getTile(x, y) = {0, (uint8_t)(1 + rng() % 4), (uint8_t)(1 + rng() % 4)};
+    }
+  }
+
+  for (int i = 0; i < size * size / 20; i++) {
+    Vec2d position = {1 + rng() % ((size - 2) * 100) / 100.0, 1 + rng() % ((size - 2) * 100) / 100.0};
+    if (!map.getTile({(int)position.x, (int)position.y}).isSolid()) {
+      scene.sprites.push_back(position);
+    }
+  }
+
+  return scene;
+}
+
+static float getMaxHeight(const Map& map) {
+  int height = 1;
+  for (auto& tile : map.tiles) {
+    if (tile.isSolid()) {
+      height = std::max(height, tile.getWallHeight());
+    }
+  }
+  return height;
+}
+
+// Axis aligned and diagonal views first, those are the usual suspects, then random ones
+static std::vector<Pose> generatePoses(const Map& map, int count, std::mt19937& rng) {
+  std::vector<Vec2i> openTiles;
+  for (int y = 0; y < map.height; y++) {
+    for (int x = 0; x < map.width; x++) {
+      if (!map.getTile(x, y).isSolid()) {
+        openTiles.push_back({x, y});
+      }
+    }
+  }
+
+  std::vector<Pose> poses;
+  if (openTiles.empty()) {
+    return poses;
+  }
+
+  const float FIXED_ANGLES[] = {0.0f, (float)M_PI / 2, (float)M_PI / 4, (float)M_PI};
+  for (int i = 0; i < count; i++) {
+    Vec2i tile = openTiles[rng() % openTiles.size()];
+
+    Pose pose;
+    pose.view.position = {tile.x + (rng() % 1000) / 1000.0, tile.y + (rng() % 1000) / 1000.0};
+    pose.view.angle = i < 4 ? FIXED_ANGLES[i] : (rng() % 62832) / 10000.0f;
+    pose.previous = pose.view;
+    pose.previous.angle -= 0.01f + (rng() % 100) / 5000.0f;
+    poses.push_back(pose);
+  }
+
+  return poses;
+}
+
+static void castReference(const Scene& scene, const reference::View& view, int width, ColumnHits& columns) {
+  for (int x = 0; x < width; x++) {
+    Ray ray = reference::getColumnRay(view, x, width);
+    float coveredSlope = reference::getCoveredSlope(view, x, width);
+    columns.layers[x] = reference::castRayLayers(scene.map, ray, COLUMN_EYE_HEIGHT, coveredSlope, scene.maxHeight, columns.get(x), COLUMN_MAX_LAYERS);
+  }
+}
+
+static void castColumn(const Scene& scene, const reference::View& view, int width, ColumnHits& columns, int x) {
+  Ray ray = reference::getColumnRay(view, x, width);
+  float coveredSlope = reference::getCoveredSlope(view, x, width);
+  columns.layers[x] = castRayLayers(scene.map, ray, COLUMN_EYE_HEIGHT, coveredSlope, scene.maxHeight, columns.get(x), COLUMN_MAX_LAYERS, &columns.seeThrough[x]);
+}
+
+// The game's column jobs, only the columns of one parity when interlacing
+static void castOptimized(const Scene& scene, const reference::View& view, int width, ColumnHits& columns, int grainSize, int parity = -1) {
+  std::vector<jobs::JobHandle> chunks;
+  for (int from = 0; from < width; from += grainSize) {
+    int to = std::min(from + grainSize, width);
+    chunks.push_back(jobs::submit([&scene, &view, &columns, width, from, to, parity]() {
+      for (int x = from; x < to; x++) {
+        if (parity >= 0 && (x & 1) != parity) {
+          continue;
+        }
+        castColumn(scene, view, width, columns, x);
+      }
+    }));
+  }
+  jobs::waitAll(chunks);
+}
+
+static std::vector<reference::Sprite> transformReference(const Scene& scene, const reference::View& view) {
+  Vec2d forward = {sinf(view.angle), cosf(view.angle)};
+  Vec2d right = {forward.y, -forward.x};
+
+  std::vector<reference::Sprite> sprites(scene.sprites.size());
+  for (size_t i = 0; i < sprites.size(); i++) {
+    Vec2d vec = scene.sprites[i] - view.position;
+    sprites[i] = {(uint32_t)i, (float)vec.dot(forward), (float)vec.dot(right)};
+  }
+  return sprites;
+}
+
+static std::vector<reference::Sprite> transformOptimized(const Scene& scene, const reference::View& view) {
+  Vec2d forward = {sinf(view.angle), cosf(view.angle)};
+  Vec2d right = {forward.y, -forward.x};
+
+  size_t count = scene.sprites.size();
+  std::vector<float> depth(count), lateral(count);
+  transformPoints(scene.sprites.data(), count, view.position, forward, right, depth.data(), lateral.data());
+
+  std::vector<reference::Sprite> sprites(count);
+  for (size_t i = 0; i < count; i++) {
+    sprites[i] = {(uint32_t)i, depth[i], lateral[i]};
+  }
+  return sprites;
+}
+
+static void drawFrame(reference::Frame& frame, const Scene& scene, const reference::View& view, ColumnHits& columns, std::vector<reference::Sprite> sprites) {
+  frame.clear();
+  for (int x = 0; x < frame.width; x++) {
+    reference::drawColumn(frame, scene.map, view, x, columns.get(x), columns.layers[x]);
+  }
+
+  std::stable_sort(sprites.begin(), sprites.end(), [](const reference::Sprite& a, const reference::Sprite& b) {
+    return a.depth > b.depth;
+  });
+  reference::drawSprites(frame, view, sprites.data(), sprites.size());
+}
+
+static bool isClose(uint32_t a, uint32_t b, int tolerance) {
+  for (int shift = 0; shift < 24; shift += 8) {
+    if (std::abs((int)((a >> shift) & 0xff) - (int)((b >> shift) & 0xff)) > tolerance) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static std::string describeHit(const RayHit* hits, int count) {
+  if (!count) {
+    return "nothing";
+  }
+  char buffer[96];
+  snprintf(buffer, sizeof(buffer), "%d layers, d=%.5f tile %d,%d side %d u=%.4f",
+    count, hits[0].distance, hits[0].tile.x, hits[0].tile.y, (int)hits[0].side, hits[0].sampleX);
+  return buffer;
+}
+
+// Returns the number of mismatching columns and prints the first few
+static int compareFrames(const std::string& label, const Options& options, const reference::Frame& expected, const reference::Frame& actual, ColumnHits& expectedHits, ColumnHits& actualHits) {
+  int badColumns = 0, badPixels = 0;
+
+  for (int x = 0; x < expected.width; x++) {
+    int columnPixels = 0;
+    for (int y = 0; y < expected.height; y++) {
+      if (!isClose(expected.getPixel(x, y), actual.getPixel(x, y), options.tolerance)) {
+        columnPixels++;
+      }
+    }
+
+    if (!columnPixels) {
+      continue;
+    }
+
+    if (badColumns++ < options.reportColumns) {
+      printf("  %s x=%d: %d px\n    reference: %s\n    optimized: %s\n", label.c_str(), x, columnPixels,
+        describeHit(expectedHits.get(x), expectedHits.layers[x]).c_str(), describeHit(actualHits.get(x), actualHits.layers[x]).c_str());
+    }
+    badPixels += columnPixels;
+  }
+
+  if (badColumns) {
+    printf("  %s: %d columns, %d pixels differ\n", label.c_str(), badColumns, badPixels);
+  }
+  return badColumns;
+}
+
+int main(int argc, char ** argv) {
+  Options options;
+  std::vector<std::string> mapFiles;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg[0] == '-' && i + 1 >= argc) {
+      error("Usage: %s [-s WIDTHxHEIGHT] [-p POSES] [-t TOLERANCE] [-m MAX_BAD_COLUMNS] [-r REPORT_COLUMNS] [MAP_FILE...]", argv[0]);
+      return 1;
+    }
+    if (arg == "-s") {
+      std::string size = argv[++i];
+      options.width = std::max(std::stoi(size), 2);
+      options.height = std::max(std::stoi(size.substr(size.find('x') + 1)), 2);
+    } else if (arg == "-p") {
+      options.poses = std::max(std::stoi(argv[++i]), 1);
+    } else if (arg == "-t") {
+      options.tolerance = std::max(std::stoi(argv[++i]), 0);
+    } else if (arg == "-m") {
+      options.maxBadColumns = std::max(std::stod(argv[++i]), 0.0);
+    } else if (arg == "-r") {
+      options.reportColumns = std::max(std::stoi(argv[++i]), 0);
+    } else {
+      mapFiles.push_back(arg);
+    }
+  }
+
+  std::mt19937 rng(1234);
+  std::vector<Scene> scenes;
+  for (int size : {24, 64}) {
+    scenes.push_back(generateScene(size, rng));
+  }
+  for (auto& file : mapFiles) {
+    Scene scene;
+    scene.name = file;
+    scene.map = Map::load(file);
+    if (!scene.map.isValid) {
+      return 1;
+    }
+    scenes.push_back(std::move(scene));
+  }
+
+  jobs::init();
+
+  int width = options.width, height = options.height;
+  reference::Frame expected(width, height), actual(width, height);
+  ColumnHits expectedHits, actualHits;
+  expectedHits.resize(width);
+  actualHits.resize(width);
+
+  long totalColumns = 0, badColumns = 0;
+
+  for (auto& scene : scenes) {
+    scene.maxHeight = getMaxHeight(scene.map);
+    std::vector<Pose> poses = generatePoses(scene.map, options.poses, rng);
+    printf("%s: %zu poses at %dx%d\n", scene.name.c_str(), poses.size(), width, height);
+
+    for (size_t p = 0; p < poses.size(); p++) {
+      const reference::View& view = poses[p].view;
+      std::string label = scene.name + " pose " + std::to_string(p);
+
+      castReference(scene, view, width, expectedHits);
+      drawFrame(expected, scene, view, expectedHits, transformReference(scene, view));
+
+      // Every column cast on the job pool
+      castOptimized(scene, view, width, actualHits, options.grainSize);
+      drawFrame(actual, scene, view, actualHits, transformOptimized(scene, view));
+      badColumns += compareFrames(label + " cast", options, expected, actual, expectedHits, actualHits);
+
+      // Half the columns carried over from the previous pose and reprojected
+      castOptimized(scene, poses[p].previous, width, actualHits, options.grainSize);
+      castOptimized(scene, view, width, actualHits, options.grainSize, 0);
+      for (int x = 1; x < width; x += 2) {
+        Ray ray = reference::getColumnRay(view, x, width);
+        if (!reprojectColumn(ray, actualHits.hits.data(), actualHits.layers.data(), actualHits.seeThrough.data(), x, width)) {
+          castColumn(scene, view, width, actualHits, x);
+        }
+      }
+      drawFrame(actual, scene, view, actualHits, transformOptimized(scene, view));
+      badColumns += compareFrames(label + " interlaced", options, expected, actual, expectedHits, actualHits);
+
+      totalColumns += 2 * width;
+    }
+  }
+
+  jobs::shutdown();
+
+  double share = totalColumns ? (double)badColumns / totalColumns : 0;
+  bool passed = share <= options.maxBadColumns;
+  printf("%s: %ld of %ld columns differ (%.3f%%, limit %.3f%%)\n", passed ? "PASS" : "FAIL", badColumns, totalColumns, share * 100, options.maxBadColumns * 100);
+
+  return passed ? 0 : 1;
+}
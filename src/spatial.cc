@@ -0,0 +1,238 @@
+#include <rayc/spatial.h>
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+void rayc::SpatialHash::reset(int mapWidth, int mapHeight, int cellSize) {
+  m_cellSize = std::max(cellSize, 1);
+  m_columns = std::max((mapWidth + m_cellSize - 1) / m_cellSize, 1);
+  m_rows = std::max((mapHeight + m_cellSize - 1) / m_cellSize, 1);
+
+  m_cells.assign(m_columns * m_rows, {});
+  m_entries.clear();
+  m_maxRadius = 0.0f;
+}
+
+void rayc::SpatialHash::clear() {
+  for (auto& cell : m_cells) {
+    cell.clear();
+  }
+  m_entries.clear();
+  m_maxRadius = 0.0f;
+}
+
+void rayc::SpatialHash::insert(ObjectHandle handle, Vec2d position, float radius) {
+  if (m_cells.empty()) {
+    return;
+  }
+
+  if (handle.index >= m_entries.size()) {
+    m_entries.resize(handle.index + 1);
+  }
+
+  if (m_entries[handle.index].cell >= 0) {
+    unlink(handle.index);
+  }
+
+  Entry& entry = m_entries[handle.index];
+  entry.handle = handle;
+  entry.position = position;
+  entry.radius = radius;
+
+  m_maxRadius = std::max(m_maxRadius, radius);
+
+  link(handle.index, getCell(position));
+}
+
+void rayc::SpatialHash::move(ObjectHandle handle, Vec2d position) {
+  if (!contains(handle)) {
+    return;
+  }
+
+  Entry& entry = m_entries[handle.index];
+  entry.position = position;
+
+  // Most moves stay inside the cell and only touch the entry
+  int cell = getCell(position);
+  if (cell != entry.cell) {
+    unlink(handle.index);
+    link(handle.index, cell);
+  }
+}
+
+void rayc::SpatialHash::remove(ObjectHandle handle) {
+  if (!contains(handle)) {
+    return;
+  }
+
+  unlink(handle.index);
+  m_entries[handle.index].handle = {};
+}
+
+bool rayc::SpatialHash::contains(ObjectHandle handle) const {
+  return handle.index < m_entries.size()
+    && m_entries[handle.index].cell >= 0
+    && m_entries[handle.index].handle == handle;
+}
+
+void rayc::SpatialHash::queryRadius(Vec2d center, float radius, std::vector<ObjectHandle>& result) const {
+  if (m_cells.empty()) {
+    return;
+  }
+
+  float reach = radius + m_maxRadius;
+
+  int fromX = std::max((int)std::floor((center.x - reach) / m_cellSize), 0);
+  int fromY = std::max((int)std::floor((center.y - reach) / m_cellSize), 0);
+  int toX = std::min((int)std::floor((center.x + reach) / m_cellSize), m_columns - 1);
+  int toY = std::min((int)std::floor((center.y + reach) / m_cellSize), m_rows - 1);
+
+  for (int y = fromY; y <= toY; y++) {
+    for (int x = fromX; x <= toX; x++) {
+      for (uint32_t index : m_cells[y * m_columns + x]) {
+        const Entry& entry = m_entries[index];
+        Vec2d delta = entry.position - center;
+        float limit = radius + entry.radius;
+
+        if (delta.dot(delta) <= limit * limit) {
+          result.push_back(entry.handle);
+        }
+      }
+    }
+  }
+}
+
+void rayc::SpatialHash::queryOverlaps(ObjectHandle handle, std::vector<ObjectHandle>& result) const {
+  if (!contains(handle)) {
+    return;
+  }
+
+  const Entry& entry = m_entries[handle.index];
+  size_t first = result.size();
+
+  queryRadius(entry.position, entry.radius, result);
+
+  auto self = std::find(result.begin() + first, result.end(), handle);
+  if (self != result.end()) {
+    result.erase(self);
+  }
+}
+
+bool rayc::SpatialHash::overlaps(ObjectHandle a, ObjectHandle b) const {
+  if (!contains(a) || !contains(b)) {
+    return false;
+  }
+
+  const Entry& first = m_entries[a.index];
+  const Entry& second = m_entries[b.index];
+  Vec2d delta = first.position - second.position;
+  float limit = first.radius + second.radius;
+
+  return delta.dot(delta) <= limit * limit;
+}
+
+bool rayc::SpatialHash::queryRay(Vec2d origin, Vec2d direction, float maxDistance, ObjectHandle& hit, float& distance, ObjectHandle ignore) const {
+  double length = std::sqrt(direction.dot(direction));
+  if (length == 0 || m_cells.empty()) {
+    return false;
+  }
+  direction /= length;
+
+  Vec2d cellOrigin = origin / (double)m_cellSize;
+  Vec2i cell = {(int)std::floor(cellOrigin.x), (int)std::floor(cellOrigin.y)};
+
+  if (cell.x < 0 || cell.y < 0 || cell.x >= m_columns || cell.y >= m_rows) {
+    return false;
+  }
+
+  const double inf = std::numeric_limits<double>::infinity();
+  Vec2d delta = {
+    direction.x != 0 ? std::fabs(m_cellSize / direction.x) : inf,
+    direction.y != 0 ? std::fabs(m_cellSize / direction.y) : inf
+  };
+  Vec2i step = {direction.x < 0 ? -1 : 1, direction.y < 0 ? -1 : 1};
+  Vec2d side = {
+    direction.x < 0 ? (cellOrigin.x - cell.x) * delta.x : (cell.x + 1 - cellOrigin.x) * delta.x,
+    direction.y < 0 ? (cellOrigin.y - cell.y) * delta.y : (cell.y + 1 - cellOrigin.y) * delta.y
+  };
+
+  // A circle filed in a neighbouring cell can still poke into this one
+  int ring = (int)std::ceil(m_maxRadius / m_cellSize);
+  double best = maxDistance;
+  double cellEnter = 0.0;
+  bool found = false;
+
+  while (cellEnter <= best) {
+    for (int y = std::max(cell.y - ring, 0); y <= std::min(cell.y + ring, m_rows - 1); y++) {
+      for (int x = std::max(cell.x - ring, 0); x <= std::min(cell.x + ring, m_columns - 1); x++) {
+        for (uint32_t index : m_cells[y * m_columns + x]) {
+          const Entry& entry = m_entries[index];
+          if (entry.handle == ignore) {
+            continue;
+          }
+
+          Vec2d toCenter = entry.position - origin;
+          double t = toCenter.dot(direction);
+          double missSquared = toCenter.dot(toCenter) - t * t;
+          double radiusSquared = entry.radius * entry.radius;
+
+          if (missSquared > radiusSquared) {
+            continue;
+          }
+
+          double tHit = std::max(t - std::sqrt(radiusSquared - missSquared), 0.0);
+          if (t >= 0 && tHit <= best) {
+            best = tHit;
+            hit = entry.handle;
+            found = true;
+          }
+        }
+      }
+    }
+
+    if (side.x < side.y) {
+      cellEnter = side.x;
+      side.x += delta.x;
+      cell.x += step.x;
+    } else {
+      cellEnter = side.y;
+      side.y += delta.y;
+      cell.y += step.y;
+    }
+
+    if (cell.x < 0 || cell.y < 0 || cell.x >= m_columns || cell.y >= m_rows) {
+      break;
+    }
+  }
+
+  if (found) {
+    distance = best;
+  }
+  return found;
+}
+
+int rayc::SpatialHash::getCell(Vec2d position) const {
+  int x = std::min(std::max((int)std::floor(position.x / m_cellSize), 0), m_columns - 1);
+  int y = std::min(std::max((int)std::floor(position.y / m_cellSize), 0), m_rows - 1);
+  return y * m_columns + x;
+}
+
+void rayc::SpatialHash::link(uint32_t index, int cell) {
+  Entry& entry = m_entries[index];
+  entry.cell = cell;
+  entry.cellSlot = m_cells[cell].size();
+  m_cells[cell].push_back(index);
+}
+
+void rayc::SpatialHash::unlink(uint32_t index) {
+  Entry& entry = m_entries[index];
+  std::vector<uint32_t>& bucket = m_cells[entry.cell];
+
+  uint32_t moved = bucket.back();
+  bucket[entry.cellSlot] = moved;
+  m_entries[moved].cellSlot = entry.cellSlot;
+  bucket.pop_back();
+
+  entry.cell = -1;
+}
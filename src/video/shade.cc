@@ -0,0 +1,47 @@
+#include <rayc/video/shade.h>
+
+#include <algorithm>
+
+rayc::ShadeTable::ShadeTable() {
+  build({});
+}
+
+void rayc::ShadeTable::build(const MapFog& fog) {
+  m_fog = fog;
+  m_distanceScale = fog.enabled && fog.end > 0 ? DISTANCE_STEPS / fog.end : 0.0f;
+
+  // Black fog only darkens, so it goes into the color mod and needs no overlay
+  bool overlay = hasOverlay();
+
+  for (int level = 0; level < LIGHT_LEVELS; level++) {
+    float light = level / (float)(LIGHT_LEVELS - 1);
+
+    for (int step = 0; step < DISTANCE_STEPS; step++) {
+      float amount = 0.0f;
+      if (fog.enabled) {
+        float distance = (step + 0.5f) / m_distanceScale;
+        amount = std::min(std::max((distance - fog.start) / std::max(fog.end - fog.start, 0.001f), 0.0f), 1.0f);
+      }
+
+      uint8_t mod = std::min(light * (overlay ? 1.0f : 1.0f - amount) * 256.0f, 255.0f);
+      m_shades[level * DISTANCE_STEPS + step] = {mod, mod, mod, (uint8_t)(overlay ? amount * 255.0f : 0)};
+    }
+  }
+}
+
+uint8_t rayc::ShadeTable::lookupDimmed(float distance, uint8_t light) const {
+  const Shade& shade = lookup(distance, light);
+  return shade.r * (255 - shade.fog) / 255;
+}
+
+float rayc::ShadeTable::getCutoff(float maxDistance) const {
+  return m_fog.enabled ? std::min(maxDistance, m_fog.end) : maxDistance;
+}
+
+bool rayc::ShadeTable::hasOverlay() const {
+  return m_fog.enabled && (m_fog.r || m_fog.g || m_fog.b);
+}
+
+const rayc::MapFog& rayc::ShadeTable::getFog() const {
+  return m_fog;
+}
@@ -0,0 +1,91 @@
+#include <rayc/video/sprite.h>
+
+#include <algorithm>
+
+void rayc::DepthSummary::build(const float* depth, int width) {
+  m_depth = depth;
+  m_width = width;
+
+  int blocks = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  m_min.resize(blocks);
+  m_max.resize(blocks);
+
+  for (int block = 0; block < blocks; block++) {
+    int from = block * BLOCK_SIZE;
+    int to = std::min(from + BLOCK_SIZE, width);
+
+    float min = depth[from], max = depth[from];
+    for (int x = from + 1; x < to; x++) {
+      min = std::min(min, depth[x]);
+      max = std::max(max, depth[x]);
+    }
+
+    m_min[block] = min;
+    m_max[block] = max;
+  }
+}
+
+float rayc::DepthSummary::getMinDepth(int from, int to) const {
+  float min = m_min[from / BLOCK_SIZE];
+  for (int block = from / BLOCK_SIZE + 1; block <= (to - 1) / BLOCK_SIZE; block++) {
+    min = std::min(min, m_min[block]);
+  }
+  return min;
+}
+
+float rayc::DepthSummary::getMaxDepth(int from, int to) const {
+  float max = m_max[from / BLOCK_SIZE];
+  for (int block = from / BLOCK_SIZE + 1; block <= (to - 1) / BLOCK_SIZE; block++) {
+    max = std::max(max, m_max[block]);
+  }
+  return max;
+}
+
+bool rayc::DepthSummary::isOccluded(int from, int to, float depth) const {
+  if (getMaxDepth(from, to) < depth) {
+    return true;
+  }
+
+  // Blocks at the edges can be only partly covered, settle those per column
+  for (int x = from; x < to; x++) {
+    if (m_depth[x] >= depth) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool rayc::DepthSummary::isUnoccluded(int from, int to, float depth) const {
+  return getMinDepth(from, to) >= depth;
+}
+
+void rayc::sortSpritesBackToFront(std::vector<SpriteInstance>& sprites, std::vector<SpriteInstance>& scratch, float maxDepth) {
+  for (auto& sprite : sprites) {
+    float normalized = std::min(std::max(sprite.depth / maxDepth, 0.0f), 1.0f);
+    sprite.depthKey = 0xffff - (uint16_t)(normalized * 0xffff);
+  }
+
+  scratch.resize(sprites.size());
+
+  // Two stable 8-bit LSD passes over the 16-bit key
+  for (int shift = 0; shift < 16; shift += 8) {
+    size_t offsets[256] = {0};
+
+    for (auto& sprite : sprites) {
+      offsets[(sprite.depthKey >> shift) & 0xff]++;
+    }
+
+    size_t total = 0;
+    for (int i = 0; i < 256; i++) {
+      size_t count = offsets[i];
+      offsets[i] = total;
+      total += count;
+    }
+
+    for (auto& sprite : sprites) {
+      scratch[offsets[(sprite.depthKey >> shift) & 0xff]++] = sprite;
+    }
+
+    sprites.swap(scratch);
+  }
+}
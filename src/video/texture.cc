@@ -4,10 +4,29 @@
 
 #include <SDL2/SDL_image.h>
 
+#include <algorithm>
+
 rayc::Texture::Texture() {}
 
-rayc::Texture::Texture(const std::string& filename) : m_filename(filename) {
-  m_texture = IMG_LoadTexture(getRenderer(), filename.c_str());
+rayc::Texture::Texture(const std::string& filename, int flags) : m_filename(filename) {
+  if (flags & (TEXTURE_OPAQUE_SPANS | TEXTURE_KEEP_PIXELS)) {
+    SDL_Surface* surface = IMG_Load(filename.c_str());
+    if (!surface) {
+      error("Error loading texture '%s'", filename.c_str());
+      die();
+    }
+    if (flags & TEXTURE_OPAQUE_SPANS) {
+      buildSpans(surface);
+    }
+    if (flags & TEXTURE_KEEP_PIXELS) {
+      copyPixels(surface);
+    }
+    m_texture = SDL_CreateTextureFromSurface(getRenderer(), surface);
+    SDL_FreeSurface(surface);
+  } else {
+    m_texture = IMG_LoadTexture(getRenderer(), filename.c_str());
+  }
+
   if (!m_texture) {
     error("Error loading texture '%s'", filename.c_str());
     die();
@@ -17,20 +36,30 @@ rayc::Texture::Texture(const std::string& filename) : m_filename(filename) {
   debug("Texture(%s) %p", filename.c_str(), m_texture);
 }
 
-rayc::Texture::Texture(int w, int h) {
+rayc::Texture::Texture(int w, int h, int flags) {
   m_width = w;
   m_height = h;
-  m_texture = SDL_CreateTexture(getRenderer(), SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, w, h);
+  int access = flags & TEXTURE_STREAMING ? SDL_TEXTUREACCESS_STREAMING : SDL_TEXTUREACCESS_TARGET;
+  m_texture = SDL_CreateTexture(getRenderer(), SDL_PIXELFORMAT_RGBA8888, access, w, h);
   if (!m_texture) {
     error("Error creating texture %dx%d", w, h);
     die();
   }
+
+  // Software passes leave transparent holes for whatever was drawn underneath
+  if (flags & TEXTURE_STREAMING) {
+    SDL_SetTextureBlendMode(m_texture, SDL_BLENDMODE_BLEND);
+  }
 }
 
 rayc::Texture::Texture(Texture&& rhs) {
   m_texture = rhs.m_texture;
   m_width = rhs.m_width;
   m_height = rhs.m_height;
+  m_colorMod = rhs.m_colorMod;
+  m_spans = std::move(rhs.m_spans);
+  m_spanOffsets = std::move(rhs.m_spanOffsets);
+  m_pixels = std::move(rhs.m_pixels);
 
   rhs.m_texture = nullptr;
 }
@@ -42,9 +71,17 @@ rayc::Texture::~Texture() {
 }
 
 rayc::Texture& rayc::Texture::operator=(rayc::Texture&& rhs) {
+  if (m_texture && m_texture != rhs.m_texture) {
+    SDL_DestroyTexture(m_texture);
+  }
+
   m_texture = rhs.m_texture;
   m_width = rhs.m_width;
   m_height = rhs.m_height;
+  m_colorMod = rhs.m_colorMod;
+  m_spans = std::move(rhs.m_spans);
+  m_spanOffsets = std::move(rhs.m_spanOffsets);
+  m_pixels = std::move(rhs.m_pixels);
 
   rhs.m_texture = nullptr;
   return *this;
@@ -60,10 +97,98 @@ SDL_Texture* rayc::Texture::getSdlTexture() const {
 
 // SDL_Surface* rayc::Texture::getPixels() const {}
 
+const uint32_t* rayc::Texture::getPixels() const {
+  return m_pixels.empty() ? nullptr : m_pixels.data();
+}
+
+void rayc::Texture::update(const uint32_t* pixels) {
+  SDL_UpdateTexture(m_texture, NULL, pixels, m_width * sizeof(uint32_t));
+}
+
+void rayc::Texture::update(const uint32_t* pixels, const SDL_Rect& area, int pitch) {
+  SDL_UpdateTexture(m_texture, &area, pixels, pitch * sizeof(uint32_t));
+}
+
+void rayc::Texture::setColorMod(uint8_t r, uint8_t g, uint8_t b) {
+  uint32_t colorMod = r << 16 | g << 8 | b;
+  if (colorMod != m_colorMod) {
+    SDL_SetTextureColorMod(m_texture, r, g, b);
+    m_colorMod = colorMod;
+  }
+}
+
 int rayc::Texture::getWidth() const {
   return m_width;
 }
 
 int rayc::Texture::getHeight() const {
   return m_height;
-}
\ No newline at end of file
+}
+
+bool rayc::Texture::hasSpans() const {
+  return !m_spanOffsets.empty();
+}
+
+const rayc::TextureSpan* rayc::Texture::getSpans(int column) const {
+  return m_spans.data() + m_spanOffsets[column];
+}
+
+int rayc::Texture::getSpanCount(int column) const {
+  return m_spanOffsets[column + 1] - m_spanOffsets[column];
+}
+
+void rayc::Texture::buildSpans(SDL_Surface* surface) {
+  SDL_Surface* rgba = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA8888, 0);
+  if (!rgba) {
+    sdlError("Failed to convert '%s' for span building", m_filename.c_str());
+    return;
+  }
+
+  SDL_LockSurface(rgba);
+
+  m_spans.clear();
+  m_spanOffsets.resize(rgba->w + 1);
+
+  for (int x = 0; x < rgba->w; x++) {
+    m_spanOffsets[x] = m_spans.size();
+
+    int start = -1;
+    for (int y = 0; y <= rgba->h; y++) {
+      bool opaque = false;
+      if (y < rgba->h) {
+        uint32_t pixel = ((uint32_t*)((uint8_t*)rgba->pixels + y * rgba->pitch))[x];
+        opaque = (pixel & 0xff) != 0;
+      }
+
+      if (opaque && start < 0) {
+        start = y;
+      } else if (!opaque && start >= 0) {
+        m_spans.push_back({(uint16_t)start, (uint16_t)y});
+        start = -1;
+      }
+    }
+  }
+  m_spanOffsets[rgba->w] = m_spans.size();
+
+  SDL_UnlockSurface(rgba);
+  SDL_FreeSurface(rgba);
+}
+
+void rayc::Texture::copyPixels(SDL_Surface* surface) {
+  SDL_Surface* rgba = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA8888, 0);
+  if (!rgba) {
+    sdlError("Failed to convert '%s' for a pixel copy", m_filename.c_str());
+    return;
+  }
+
+  SDL_LockSurface(rgba);
+
+  m_pixels.resize(rgba->w * rgba->h);
+  for (int y = 0; y < rgba->h; y++) {
+    const uint32_t* row = (const uint32_t*)((uint8_t*)rgba->pixels + y * rgba->pitch);
+    std::copy(row, row + rgba->w, m_pixels.begin() + y * rgba->w);
+  }
+
+  SDL_UnlockSurface(rgba);
+  SDL_FreeSurface(rgba);
+}
@@ -0,0 +1,89 @@
+#include <rayc/visibility.h>
+#include <rayc/jobs.h>
+#include <rayc/dda.h>
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+// Center and corners of a tile, a viewer can stand anywhere inside it
+static const double SAMPLE_POINTS[][2] = {{0.5, 0.5}, {0.05, 0.05}, {0.95, 0.05}, {0.05, 0.95}, {0.95, 0.95}};
+
+static bool blocksSight(const rayc::MapTile& tile) {
+  return tile.isSolid() && !tile.isDoor() && !tile.isSeeThrough();
+}
+
+void rayc::buildVisibility(Map& map, int clusterSize) {
+  MapVisibility& visibility = map.visibility;
+  visibility.clear();
+
+  if (clusterSize <= 0 || !map.width || !map.height) {
+    return;
+  }
+
+  visibility.clusterSize = clusterSize;
+  visibility.columns = (map.width + clusterSize - 1) / clusterSize;
+  visibility.rows = (map.height + clusterSize - 1) / clusterSize;
+
+  int clusters = visibility.getClusterCount();
+
+  // Arc length between neighbouring rays at the far end of the map is at most half a tile
+  double diagonal = std::sqrt((double)map.width * map.width + (double)map.height * map.height);
+  int rays = std::clamp((int)std::ceil(2.0 * M_PI * diagonal / 0.5), VISIBILITY_MIN_RAYS, VISIBILITY_MAX_RAYS);
+
+  std::vector<Vec2d> directions(rays);
+  for (int i = 0; i < rays; i++) {
+    double angle = 2.0 * M_PI * (i + 0.5) / rays;
+    directions[i] = {std::cos(angle), std::sin(angle)};
+  }
+
+  // A byte per pair while building, each job only writes the rows of its own clusters
+  std::vector<uint8_t> seen((size_t)clusters * clusters, 0);
+
+  jobs::parallelFor(0, clusters, 1, [&map, &visibility, &seen, &directions, clusters](int from, int to) {
+    for (int cluster = from; cluster < to; cluster++) {
+      uint8_t* row = &seen[(size_t)cluster * clusters];
+      row[cluster] = 1;
+
+      int size = visibility.clusterSize;
+      int startX = (cluster % visibility.columns) * size, startY = (cluster / visibility.columns) * size;
+
+      for (int y = startY; y < startY + size && y < map.height; y++) {
+        for (int x = startX; x < startX + size && x < map.width; x++) {
+          if (blocksSight(map.getTile(x, y))) {
+            continue;
+          }
+
+          for (auto& point : SAMPLE_POINTS) {
+            for (auto& direction : directions) {
+              GridDDA dda({x + point[0], y + point[1]}, direction);
+
+              // The wall that stops the ray is marked too, openCluster() relies on it
+              while (true) {
+                dda.advance();
+                if (!map.contains(dda.tile)) {
+                  break;
+                }
+
+                row[visibility.getCluster(dda.tile)] = 1;
+                if (blocksSight(map.getTile(dda.tile))) {
+                  break;
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  });
+
+  // Packed symmetric, a sightline works both ways even where the sampling only caught one
+  visibility.bits.assign(((size_t)clusters * clusters + 7) / 8, 0);
+  for (int a = 0; a < clusters; a++) {
+    for (int b = a; b < clusters; b++) {
+      if (seen[(size_t)a * clusters + b] || seen[(size_t)b * clusters + a]) {
+        visibility.setVisible(a, b);
+      }
+    }
+  }
+}